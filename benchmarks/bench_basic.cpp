@@ -1,8 +1,10 @@
+#include <map>
 #include <random>
 
 #include <benchmark/benchmark.h>
 
 #include <ashdb/ashdb.h>
+#include <ashdb/crc32c.h>
 
 #include "../tests/Person.h"
 
@@ -52,6 +54,34 @@ static void DBOpenClose(benchmark::State& state)
 }
 BENCHMARK(DBOpenClose);
 
+// opening databases of different sizes, where the argument is the
+// number of segments in the database
+static void DBOpenSegments(benchmark::State& state)
+{
+    const auto segmentCount = static_cast<std::size_t>(state.range(0));
+
+    ashdb::Options options;
+    options.filesize_max = 1;
+
+    // only build each database the first time this benchmark is run
+    static std::map<std::size_t, std::string> folders;
+    auto& tempfolder = folders[segmentCount];
+    if (tempfolder.empty())
+    {
+        tempfolder = tempFolder("DBOpenSegments" + std::to_string(segmentCount));
+        ashdb::AshDB<int> db{ tempfolder, options };
+        db.open();
+        db.write(ashdb::AshDB<int>::Batch(segmentCount, 3));
+    }
+
+    while (state.KeepRunning())
+    {
+        ashdb::AshDB<int> db{ tempfolder, options };
+        db.open();
+    }
+}
+BENCHMARK(DBOpenSegments)->Arg(0)->Arg(10)->Arg(10000);
+
 static void DBWriteInt(benchmark::State& state)
 {
     auto tempfolder = (tempFolder("DBWriteInt"));
@@ -69,6 +99,38 @@ static void DBWriteInt(benchmark::State& state)
 }
 BENCHMARK(DBWriteInt);
 
+static void DBWriteIntBuffered(benchmark::State& state)
+{
+    auto tempfolder = (tempFolder("DBWriteIntBuffered"));
+
+    ashdb::Options options;
+    options.write_buffer_size = 64 * 1024;
+    ashdb::AshDB<int> db{ tempfolder, options };
+    db.open();
+
+    while (state.KeepRunning())
+    {
+        db.write(3);
+    }
+}
+BENCHMARK(DBWriteIntBuffered);
+
+static void DBWriteIntFixed(benchmark::State& state)
+{
+    auto tempfolder = (tempFolder("DBWriteIntFixed"));
+
+    ashdb::Options options;
+    options.fixed_record_size = sizeof(int);
+    ashdb::AshDB<int> db{ tempfolder, options };
+    db.open();
+
+    while (state.KeepRunning())
+    {
+        db.write(3);
+    }
+}
+BENCHMARK(DBWriteIntFixed);
+
 static void DBMultipleIntWrites(benchmark::State& state)
 {
     auto tempfolder = (tempFolder("DBMultipleIntWrites"));
@@ -121,6 +183,518 @@ static void DBRandomIntReads(benchmark::State& state)
 }
 BENCHMARK(DBRandomIntReads);
 
+// reads a million ints in one call, since ints are raw records each segment
+// is copied straight into the returned vector
+static void DBBulkIntReads(benchmark::State& state)
+{
+    constexpr auto RecordCount = 1000000u;
+
+    ashdb::Options options;
+    options.filesize_max = 1024 * 1024;
+
+    static const std::string tempfolder = [&options]()
+    {
+        const auto folder = tempFolder("DBBulkIntReads");
+        ashdb::AshDB<int> db{ folder, options };
+        db.open();
+        db.write(ashdb::AshDB<int>::Batch(RecordCount, 3));
+        return folder;
+    }();
+
+    ashdb::AshDB<int> db{ tempfolder, options };
+    db.open();
+
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(db.read(0, RecordCount));
+    }
+
+    state.SetBytesProcessed(state.iterations() * RecordCount * sizeof(int));
+}
+BENCHMARK(DBBulkIntReads);
+
+// reads records that aren't raw records in chunks of 10k
+static void DBChunkedStructReads(benchmark::State& state)
+{
+    constexpr auto RecordCount = 100000u;
+    constexpr auto ChunkSize = 10000u;
+
+    ashdb::Options options;
+    options.filesize_max = 1024 * 1024;
+
+    static const std::string tempfolder = [&options]()
+    {
+        const auto folder = tempFolder("DBChunkedStructReads");
+        project::PersonDB db{ folder, options };
+        db.open();
+
+        project::PersonDB::Batch batch;
+        for (auto i = 0u; i < RecordCount; ++i)
+        {
+            batch.push_back(project::Person::CreatePerson(i));
+        }
+        db.write(batch);
+        return folder;
+    }();
+
+    project::PersonDB db{ tempfolder, options };
+    db.open();
+
+    for (auto _ : state)
+    {
+        for (auto i = 0u; i < RecordCount; i += ChunkSize)
+        {
+            benchmark::DoNotOptimize(db.read(i, ChunkSize));
+        }
+    }
+
+    state.SetItemsProcessed(state.iterations() * RecordCount);
+}
+BENCHMARK(DBChunkedStructReads);
+
+// filters the same records with `scan`, decoding only one in ten
+static void DBScanStructs(benchmark::State& state)
+{
+    constexpr auto RecordCount = 100000u;
+
+    ashdb::Options options;
+    options.filesize_max = 1024 * 1024;
+
+    static const std::string tempfolder = [&options]()
+    {
+        const auto folder = tempFolder("DBScanStructs");
+        project::PersonDB db{ folder, options };
+        db.open();
+
+        project::PersonDB::Batch batch;
+        for (auto i = 0u; i < RecordCount; ++i)
+        {
+            batch.push_back(project::Person::CreatePerson(i));
+        }
+        db.write(batch);
+        return folder;
+    }();
+
+    project::PersonDB db{ tempfolder, options };
+    db.open();
+
+    for (auto _ : state)
+    {
+        std::size_t kept = 0;
+        db.scan(0, RecordCount, [&kept](std::size_t index, std::string_view bytes)
+        {
+            if (index % 10 == 0)
+            {
+                benchmark::DoNotOptimize(project::PersonDB::decode(bytes));
+                kept++;
+            }
+        });
+        benchmark::DoNotOptimize(kept);
+    }
+
+    state.SetItemsProcessed(state.iterations() * RecordCount);
+}
+BENCHMARK(DBScanStructs);
+
+// writes batches of records with compression off (0) or on (1), reporting
+// how many bytes the records take up on disk relative to uncompressed
+static void DBWriteStructsCompressed(benchmark::State& state)
+{
+    constexpr auto RecordCount = 10000u;
+
+    ashdb::Options options;
+    options.filesize_max = 1024 * 1024;
+    options.compression = state.range(0) ? ashdb::Compression::LZ : ashdb::Compression::NONE;
+
+    project::PersonDB db{ tempFolder("DBWriteStructsCompressed" + std::to_string(state.range(0))), options };
+    db.open();
+
+    project::PersonDB::Batch batch;
+    for (auto i = 0u; i < RecordCount; ++i)
+    {
+        batch.push_back(project::Person::CreatePerson(i));
+    }
+
+    for (auto _ : state)
+    {
+        db.write(batch);
+    }
+
+    db.close();
+    db.open();
+    state.SetItemsProcessed(state.iterations() * RecordCount);
+    state.counters["bytes/record"] = static_cast<double>(db.databaseSize()) / static_cast<double>(db.size());
+}
+BENCHMARK(DBWriteStructsCompressed)->Arg(0)->Arg(1);
+
+// the same as `DBScanStructs` with compression off (0) or on (1), every
+// block is decompressed once as the scan reaches it
+static void DBScanStructsCompressed(benchmark::State& state)
+{
+    constexpr auto RecordCount = 100000u;
+
+    ashdb::Options options;
+    options.filesize_max = 1024 * 1024;
+    options.compression = state.range(0) ? ashdb::Compression::LZ : ashdb::Compression::NONE;
+
+    static std::map<std::int64_t, std::string> folders;
+    auto& tempfolder = folders[state.range(0)];
+    if (tempfolder.empty())
+    {
+        tempfolder = tempFolder("DBScanStructsCompressed" + std::to_string(state.range(0)));
+        project::PersonDB db{ tempfolder, options };
+        db.open();
+
+        project::PersonDB::Batch batch;
+        for (auto i = 0u; i < RecordCount; ++i)
+        {
+            batch.push_back(project::Person::CreatePerson(i));
+        }
+        db.write(batch);
+    }
+
+    project::PersonDB db{ tempfolder, options };
+    db.open();
+
+    for (auto _ : state)
+    {
+        std::size_t kept = 0;
+        db.scan(0, RecordCount, [&kept](std::size_t index, std::string_view bytes)
+        {
+            if (index % 10 == 0)
+            {
+                benchmark::DoNotOptimize(project::PersonDB::decode(bytes));
+                kept++;
+            }
+        });
+        benchmark::DoNotOptimize(kept);
+    }
+
+    state.SetItemsProcessed(state.iterations() * RecordCount);
+    state.counters["bytes/record"] = static_cast<double>(db.databaseSize()) / RecordCount;
+}
+BENCHMARK(DBScanStructsCompressed)->Arg(0)->Arg(1);
+
+// checksums blocks of the given size with the portable (0) or the SSE4.2
+// (1) implementation of CRC32C
+static void Crc32c(benchmark::State& state)
+{
+    const std::string data(static_cast<std::size_t>(state.range(1)), 'x');
+    const bool accelerated = state.range(0) != 0;
+    if (accelerated && !ashdb::Crc32cAccelerated())
+    {
+        state.SkipWithError("SSE4.2 is not available");
+        return;
+    }
+
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(accelerated
+            ? ashdb::Crc32c(data.data(), data.size())
+            : ashdb::Crc32cPortable(data.data(), data.size()));
+    }
+
+    state.SetBytesProcessed(state.iterations() * state.range(1));
+}
+BENCHMARK(Crc32c)->ArgsProduct({ { 0, 1 }, { 64, 4096 } });
+
+// writes batches of records without (0) and with (1) checksums, the
+// difference is the cost of checksumming at full write throughput
+static void DBWriteStructsChecksum(benchmark::State& state)
+{
+    constexpr auto RecordCount = 10000u;
+
+    ashdb::Options options;
+    options.filesize_max = 1024 * 1024;
+    options.checksums = state.range(0) != 0;
+
+    project::PersonDB db{ tempFolder("DBWriteStructsChecksum" + std::to_string(state.range(0))), options };
+    db.open();
+
+    project::PersonDB::Batch batch;
+    for (auto i = 0u; i < RecordCount; ++i)
+    {
+        batch.push_back(project::Person::CreatePerson(i));
+    }
+
+    for (auto _ : state)
+    {
+        db.write(batch);
+    }
+
+    state.SetItemsProcessed(state.iterations() * RecordCount);
+}
+BENCHMARK(DBWriteStructsChecksum)->Arg(0)->Arg(1);
+
+// single int writes without (0) and with (1) checksums
+static void DBWriteIntChecksum(benchmark::State& state)
+{
+    ashdb::Options options;
+    options.checksums = state.range(0) != 0;
+
+    ashdb::AshDB<std::uint32_t> db{ tempFolder("DBWriteIntChecksum" + std::to_string(state.range(0))), options };
+    db.open();
+
+    std::uint32_t value = 0;
+    for (auto _ : state)
+    {
+        db.write(value++);
+    }
+
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(DBWriteIntChecksum)->Arg(0)->Arg(1);
+
+// single int writes to a database that is kept to `database_max`, so the
+// oldest segment is dropped every few thousand writes
+static void DBWriteIntRetention(benchmark::State& state)
+{
+    ashdb::Options options;
+    options.write_buffer_size = 64 * 1024;
+    options.filesize_max = 64 * 1024;
+    options.database_max = 1024 * 1024;
+
+    ashdb::AshDB<std::uint32_t> db{ tempFolder("DBWriteIntRetention"), options };
+    db.open();
+
+    std::uint32_t value = 0;
+    for (auto _ : state)
+    {
+        db.write(value++);
+    }
+
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(DBWriteIntRetention);
+
+// sums a field of every record with `parallelTransformReduce` using the
+// given number of threads
+static void DBParallelReduce(benchmark::State& state)
+{
+    constexpr auto RecordCount = 200000u;
+
+    ashdb::Options options;
+    options.filesize_max = 1024 * 1024;
+
+    static const std::string tempfolder = [&options]()
+    {
+        const auto folder = tempFolder("DBParallelReduce");
+        project::PersonDB db{ folder, options };
+        db.open();
+
+        project::PersonDB::Batch batch;
+        for (auto i = 0u; i < RecordCount; ++i)
+        {
+            batch.push_back(project::Person::CreatePerson(i));
+        }
+        db.write(batch);
+        return folder;
+    }();
+
+    project::PersonDB db{ tempfolder, options };
+    db.open();
+
+    const auto threads = static_cast<std::size_t>(state.range(0));
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(db.parallelTransformReduce(0, RecordCount, 0.0,
+            std::plus<double>{},
+            [](const project::Person& person) { return person.salary; },
+            threads));
+    }
+
+    state.SetItemsProcessed(state.iterations() * RecordCount);
+}
+BENCHMARK(DBParallelReduce)->Arg(1)->Arg(2)->Arg(4)->Arg(8)->UseRealTime();
+
+// iterates every record with a range-for, without (0) and with (1)
+// prefetching the next read-ahead window
+static void DBIterateStructs(benchmark::State& state)
+{
+    constexpr auto RecordCount = 100000u;
+
+    ashdb::Options options;
+    options.filesize_max = 1024 * 1024;
+
+    static const std::string tempfolder = [&options]()
+    {
+        const auto folder = tempFolder("DBIterateStructs");
+        project::PersonDB db{ folder, options };
+        db.open();
+
+        project::PersonDB::Batch batch;
+        for (auto i = 0u; i < RecordCount; ++i)
+        {
+            batch.push_back(project::Person::CreatePerson(i));
+        }
+        db.write(batch);
+        return folder;
+    }();
+
+    options.read_ahead_prefetch = state.range(0) != 0;
+    project::PersonDB db{ tempfolder, options };
+    db.open();
+
+    for (auto _ : state)
+    {
+        for (const auto& person : db)
+        {
+            benchmark::DoNotOptimize(person);
+        }
+    }
+
+    state.SetItemsProcessed(state.iterations() * RecordCount);
+}
+BENCHMARK(DBIterateStructs)->Arg(0)->Arg(1)->UseRealTime();
+
+// random point reads from a database where every record is in its own
+// segment, which stresses the lookup of the segment containing a record
+static void DBRandomReadsManySegments(benchmark::State& state)
+{
+    constexpr auto SegmentCount = 10000u;
+
+    ashdb::Options options;
+    options.filesize_max = 1;
+
+    // building 10k segments is slow, so only do it the first time this
+    // benchmark is run
+    static const std::string tempfolder = [&options]()
+    {
+        const auto folder = tempFolder("DBRandomReadsManySegments");
+        ashdb::AshDB<int> db{ folder, options };
+        db.open();
+
+        ashdb::AshDB<int>::Batch batch(SegmentCount, 3);
+        db.write(batch);
+        return folder;
+    }();
+
+    ashdb::AshDB<int> db{ tempfolder, options };
+    db.open();
+
+    std::random_device rd;
+    std::mt19937 gen(rd());
+    std::uniform_int_distribution<std::uint32_t> distrib(0, SegmentCount - 1);
+
+    while (state.KeepRunning())
+    {
+        for (auto i = 0u; i < 100u; ++i)
+        {
+            state.PauseTiming();
+            const auto xi = distrib(gen);
+            state.ResumeTiming();
+            db.read(xi);
+        }
+    }
+}
+BENCHMARK(DBRandomReadsManySegments);
+
+// random point reads from a shared database by a growing number of threads,
+// each thread does the same amount of work so the time per iteration
+// should stay flat as long as the readers do not block each other
+static void DBConcurrentReads(benchmark::State& state)
+{
+    constexpr auto RecordCount = 100000u;
+
+    static ashdb::AshDB<project::Person>& db = []() -> ashdb::AshDB<project::Person>&
+    {
+        ashdb::Options options;
+        options.filesize_max = 1024 * 1024;
+
+        static ashdb::AshDB<project::Person> db{ tempFolder("DBConcurrentReads"), options };
+        db.open();
+
+        ashdb::AshDB<project::Person>::Batch batch;
+        for (auto i = 0u; i < RecordCount; ++i)
+        {
+            batch.push_back(project::Person::CreatePerson(i));
+        }
+        db.write(batch);
+        return db;
+    }();
+
+    std::mt19937 gen(static_cast<std::uint32_t>(state.thread_index()));
+    std::uniform_int_distribution<std::uint32_t> distrib(0, RecordCount - 1);
+
+    for (auto _ : state)
+    {
+        for (auto i = 0u; i < 100u; ++i)
+        {
+            benchmark::DoNotOptimize(db.read(distrib(gen)));
+        }
+    }
+
+    state.SetItemsProcessed(state.iterations() * 100);
+}
+BENCHMARK(DBConcurrentReads)->ThreadRange(1, 32)->UseRealTime();
+
+// single record writes to a shared database by several threads, concurrent
+// writers are committed together so the total throughput should grow with
+// the number of writers instead of every writer paying for its own append
+static void DBConcurrentWrites(benchmark::State& state)
+{
+    static ashdb::AshDB<int> db{ tempFolder("DBConcurrentWrites"), ashdb::Options{} };
+    if (state.thread_index() == 0)
+    {
+        db.open();
+    }
+
+    for (auto _ : state)
+    {
+        db.write(3);
+    }
+
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(DBConcurrentWrites)->Threads(1)->Threads(4)->Threads(16)->Threads(64)->UseRealTime();
+
+// queues single records with `writeAsync` and only waits for the last one,
+// so the records are written by the flusher thread in batches
+static void DBWriteAsync(benchmark::State& state)
+{
+    auto tempfolder = (tempFolder("DBWriteAsync"));
+
+    ashdb::AshDB<int> db{ tempfolder, ashdb::Options{} };
+    db.open();
+
+    std::future<ashdb::WriteResult> result;
+    while (state.KeepRunning())
+    {
+        for (auto i = 0u; i < 100u; ++i)
+        {
+            result = db.writeAsync(3);
+        }
+        result.wait();
+    }
+}
+BENCHMARK(DBWriteAsync);
+
+// single record writes under each `SyncPolicy`, where the argument is the
+// policy, to compare the throughput against the durability of each of them
+static void DBWriteSyncPolicy(benchmark::State& state)
+{
+    const auto policy = static_cast<ashdb::SyncPolicy>(state.range(0));
+    constexpr const char* names[] = { "none", "per-record", "per-batch", "interval" };
+
+    ashdb::Options options;
+    options.sync_policy = policy;
+    options.sync_interval = std::chrono::milliseconds(100);
+    options.sync_bytes = 1024 * 1024;
+
+    ashdb::AshDB<project::Person> db{ tempFolder("DBWriteSyncPolicy" + std::to_string(state.range(0))), options };
+    db.open();
+
+    const auto person = project::Person::CreatePerson(1);
+    for (auto _ : state)
+    {
+        db.write(person);
+    }
+
+    state.SetLabel(names[state.range(0)]);
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(DBWriteSyncPolicy)->DenseRange(0, 3);
+
 static void DBWriteStruct(benchmark::State& state)
 {
     auto tempfolder = (tempFolder("DBWriteStruct"));
@@ -219,6 +793,61 @@ static void DBRandomStructReads(benchmark::State& state)
 }
 BENCHMARK(DBRandomStructReads);
 
+// the cost of serializing a record field by field, through `std::ostream`
+// (0) and through `BufferWriter` (1)
+static void EncodePerson(benchmark::State& state)
+{
+    const auto person = project::Person::CreatePerson(7);
+
+    ashdb::RecordBuffer stream;
+    ashdb::BufferWriter writer;
+    for (auto _ : state)
+    {
+        if (state.range(0) == 0)
+        {
+            stream.clear();
+            ashdb_write(stream, person);
+            benchmark::DoNotOptimize(stream.data());
+        }
+        else
+        {
+            writer.clear();
+            ashdb_write(writer, person);
+            benchmark::DoNotOptimize(writer.data());
+        }
+    }
+
+    state.SetLabel(state.range(0) == 0 ? "ostream" : "BufferWriter");
+}
+BENCHMARK(EncodePerson)->Arg(0)->Arg(1);
+
+// the cost of decoding a record through `std::istream` (0) and through
+// `BufferReader` (1)
+static void DecodePerson(benchmark::State& state)
+{
+    ashdb::BufferWriter writer;
+    ashdb_write(writer, project::Person::CreatePerson(7));
+
+    project::Person person;
+    for (auto _ : state)
+    {
+        if (state.range(0) == 0)
+        {
+            ashdb::MemoryStream stream{ writer.data(), writer.size() };
+            ashdb_read(stream, person);
+        }
+        else
+        {
+            ashdb::BufferReader reader{ writer.data(), writer.size() };
+            ashdb_read(reader, person);
+        }
+        benchmark::DoNotOptimize(person);
+    }
+
+    state.SetLabel(state.range(0) == 0 ? "istream" : "BufferReader");
+}
+BENCHMARK(DecodePerson)->Arg(0)->Arg(1);
+
 static void BatchWriteSingleFile(benchmark::State& state)
 {
     std:size_t run = 0;
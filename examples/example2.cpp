@@ -31,6 +31,12 @@ void ashdb_write(std::ostream& stream, const Point& p)
 
 } // namespace app
 
+// a Point has no padding so its raw bytes are exactly what `ashdb_write`
+// writes, which means it can be stored with a memcpy without changing the
+// data on disk. With this the functions above are no longer used
+template<>
+struct ashdb::RawRecord<app::Point> : std::true_type {};
+
 namespace std
 {
 
@@ -0,0 +1,204 @@
+#pragma once
+#include <algorithm>
+#include <string>
+#include <cstdint>
+#include <ostream>
+#include <streambuf>
+#include <vector>
+
+#include "compression.h"
+#include "file.h"
+
+namespace ashdb
+{
+
+// An output stream that serializes into a reusable in-memory buffer, records
+// are assembled here before being handed to the appender in a single call
+class RecordBuffer final : public std::ostream
+{
+public:
+    RecordBuffer()
+        : std::ostream(nullptr)
+    {
+        rdbuf(&_streambuf);
+    }
+
+    RecordBuffer(const RecordBuffer&) = delete;
+
+    const char* data() const noexcept { return _streambuf.buffer.data(); }
+    std::size_t size() const noexcept { return _streambuf.buffer.size(); }
+
+    // empties the buffer but keeps the allocated memory for the next record
+    void clear()
+    {
+        _streambuf.buffer.clear();
+        std::ostream::clear();
+    }
+
+    // drops everything past the first `size` bytes, i.e. a record that
+    // turned out to be invalid after it was serialized
+    void truncate(std::size_t size)
+    {
+        if (size < _streambuf.buffer.size())
+        {
+            _streambuf.buffer.resize(size);
+        }
+    }
+
+private:
+    struct StreamBuf : public std::streambuf
+    {
+        std::string buffer;
+
+        int_type overflow(int_type ch) override
+        {
+            if (!traits_type::eq_int_type(ch, traits_type::eof()))
+            {
+                buffer.push_back(traits_type::to_char_type(ch));
+            }
+            return traits_type::not_eof(ch);
+        }
+
+        std::streamsize xsputn(const char_type* s, std::streamsize count) override
+        {
+            buffer.append(s, static_cast<std::size_t>(count));
+            return count;
+        }
+
+        // only supports querying the current position, i.e. `tellp()`
+        pos_type seekoff(off_type off, std::ios_base::seekdir dir,
+                         std::ios_base::openmode which) override
+        {
+            if (off != 0 || dir != std::ios_base::cur || !(which & std::ios_base::out))
+            {
+                return pos_type(off_type(-1));
+            }
+            return pos_type(static_cast<off_type>(buffer.size()));
+        }
+    };
+
+    StreamBuf _streambuf;
+};
+
+// Keeps the data file and the index file of the active segment open across
+// writes and tracks the size of both in memory so that appending a record
+// does not require any stat or open calls. The files are only reopened
+// when the segment rolls over.
+//
+// With a buffer size set, appended records are held in memory and written
+// in one call once at least that many bytes are pending, or when the
+// appender is flushed, synced or closed.
+//
+// With a codec, records are always buffered and are written as compressed
+// blocks of about `blockSize` bytes. Offsets (i.e. `dataSize()` and the
+// index entries) are then offsets into the uncompressed records, and the
+// blocks they map to are tracked by `blocks()`
+class SegmentAppender final
+{
+public:
+    explicit SegmentAppender(std::size_t bufferSize = 0,
+                             const BlockCodec* codec = nullptr,
+                             std::size_t blockSize = 0)
+        : _bufferSize{ codec != nullptr ? std::max(std::max<std::size_t>(blockSize, 1), bufferSize) : bufferSize },
+          _codec{ codec },
+          _blockSize{ std::min<std::size_t>(std::max<std::size_t>(blockSize, 1), MAX_BLOCK_SIZE) }
+    {
+    }
+
+    SegmentAppender(SegmentAppender&&) noexcept = default;
+    SegmentAppender& operator=(SegmentAppender&&) noexcept = default;
+
+    ~SegmentAppender()
+    {
+        close();
+    }
+
+    // the largest block written, which leaves room for the blocks that are
+    // up to twice the block size to fit in the 32-bit sizes of their headers
+    static constexpr std::size_t MAX_BLOCK_SIZE = 1ull << 30;
+
+    // opens (or creates) the pair of files to which records will be appended,
+    // if `indexfile` is empty then index entries are not written anywhere.
+    // An empty index file is started with `indexHeader`. A compressed data
+    // file that ends in an incomplete block is cut back to its last
+    // complete block
+    void open(const std::string& datafile, const std::string& indexfile,
+              const std::string& indexHeader = {});
+
+    // closes both files, anything still buffered is written on a best-effort
+    // basis so `flush()` should be called first to find out if that failed
+    void close() noexcept;
+
+    bool isOpen() const noexcept { return _datafile.isOpen(); }
+
+    // appends the serialized records in `data` to the data file and then
+    // appends the `count` index entries in `index` to the index file, the data
+    // is written first so that an index entry never points to missing data
+    void append(const char* data, std::size_t size,
+                const std::size_t* index, std::size_t count);
+
+    // writes any buffered records to the files
+    void flush();
+
+    // writes any buffered records and then flushes the data file and then
+    // the index file to disk, so that an index
+    // entry that reaches the disk never points to data that did not. Does
+    // nothing if nothing was appended since the last sync
+    void sync();
+
+    // the number of bytes appended to either file since the last sync
+    std::uint64_t unsyncedBytes() const noexcept { return _unsyncedBytes; }
+
+    // the number of bytes in the active data file including any buffered
+    // records, which is also the offset at which the next record will be written
+    std::uint64_t dataSize() const noexcept { return _dataSize + _pendingData.size(); }
+
+    // the number of bytes that have been written to the data file, records
+    // at or past this offset are only in `pendingData()`
+    std::uint64_t writtenDataSize() const noexcept { return _dataSize; }
+
+    // the buffered records that have not been written yet, the first byte
+    // is at offset `writtenDataSize()` of the data file
+    const std::string& pendingData() const noexcept { return _pendingData; }
+
+    // the number of bytes the data file will take up once the buffered
+    // records are written, counting them at their uncompressed size
+    std::uint64_t storedSize() const noexcept { return _fileSize + _pendingData.size(); }
+
+    // the blocks of a compressed data file that have been written so far
+    const BlockTable& blocks() const noexcept { return _blocks; }
+
+    // the number of entries in the active index file including buffered
+    // entries, not counting its header
+    std::uint64_t indexCount() const noexcept
+    {
+        return ((_indexSize - _indexHeaderSize) / sizeof(std::size_t)) + _pendingIndex.size();
+    }
+
+private:
+    // compresses the buffered records into blocks and writes them to the
+    // data file in a single call
+    void writeBlocks();
+
+    File            _datafile;
+    File            _indexfile;
+
+    std::size_t                 _bufferSize = 0;
+    std::string                 _pendingData;
+    std::vector<std::size_t>    _pendingIndex;
+
+    const BlockCodec*           _codec = nullptr;
+    std::size_t                 _blockSize = 0;
+    BlockTable                  _blocks;
+    std::string                 _blockBuffer;
+
+    // the uncompressed size of the written records and the size of the
+    // data file, which are the same when not compressing
+    std::uint64_t   _dataSize = 0;
+    std::uint64_t   _fileSize = 0;
+    std::uint64_t   _indexSize = 0;
+    std::uint64_t   _indexHeaderSize = 0;
+    std::uint64_t   _unsyncedBytes = 0;
+};
+
+} // namespace ashdb
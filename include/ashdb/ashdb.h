@@ -1,24 +1,46 @@
 #pragma once
 
+#include <algorithm>
 #include <sstream>
 #include <fstream>
 #include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
 #include <optional>
+#include <string_view>
+#include <type_traits>
 #include <vector>
 #include <filesystem>
+#include <future>
 #include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <memory>
+#include <limits>
+#include <numeric>
 #include <cassert>
-
+#include <cstring>
+
+#include "appender.h"
+#include "buffer.h"
+#include "compression.h"
+#include "crc32c.h"
+#include "mappedfile.h"
+#include "memorystream.h"
 #include "options.h"
 #include "primitives.h"
+#include "segmentcache.h"
+#include "segmentindex.h"
 #include "status.h"
+#include "threadpool.h"
 
 namespace ashdb
 {
 
 namespace fs = std::filesystem;
 
-using SegmentIndices = std::vector<std::vector<std::size_t>>;
+using SegmentIndices = std::vector<SegmentIndex>;
 
 constexpr auto INDEX_EXTENSION = "idx";
 constexpr auto VALIDCHARS = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvqxyz0123456789-_";
@@ -28,11 +50,142 @@ std::string BuildFilename(const std::string& folder,
                           const std::string& extension,
                           std::uint64_t fileindex);
 
+// the options that decide how the records of a segment are laid out in its
+// files. Every segment records the format it was written with, in its
+// header, its footer or the header of its index file, so that it is never
+// read (or recovered) with options that don't match it
+struct SegmentFormat
+{
+    Compression     compression = Compression::NONE;
+    bool            checksums = false;
+    std::uint32_t   fixedRecordSize = 0;
+
+    bool operator==(const SegmentFormat& other) const noexcept
+    {
+        return compression == other.compression
+            && checksums == other.checksums
+            && fixedRecordSize == other.fixedRecordSize;
+    }
+
+    bool operator!=(const SegmentFormat& other) const noexcept
+    {
+        return !(*this == other);
+    }
+};
+
+// the size of the header at the start of an index file, which holds a magic
+// number and the format of the segment. Index files written before segments
+// recorded their format don't have one, and are still read without it
+constexpr std::size_t INDEX_HEADER_SIZE = 16;
+
+std::string BuildIndexFileHeader(const SegmentFormat& format);
+
+// returns the entries of an index file, without its header
 std::vector<std::size_t> ReadIndexFile(const std::string& filename);
 
+// returns the sorted segment numbers of all the data files in `folder` whose
+// names match the "<prefix>-<segment>.<extension>" pattern
+std::vector<std::uint16_t> FindSegmentNumbers(const std::string& folder,
+                                              const std::string& prefix,
+                                              const std::string& extension);
+
+// the first entry of an index file and the number of entries in it, which
+// is enough to describe a segment without loading all of its offsets
+struct IndexFileSummary
+{
+    std::size_t first = 0;
+    std::size_t count = 0;
+
+    // the format recorded in the header of the file, which files written
+    // before segments recorded their format don't have
+    std::optional<SegmentFormat> format;
+};
+
+IndexFileSummary ReadIndexFileSummary(const std::string& filename);
+
+// the entries left at the end of an index file by `RecoverIndexFile`
+struct IndexFileTail
+{
+    std::size_t first = 0;
+    std::size_t count = 0;
+
+    // the offset of the last record with an entry, 0 if there is only one
+    std::size_t lastOffset = 0;
+
+    // the format recorded in the header of the index file, if it has one
+    std::optional<SegmentFormat> format;
+};
+
+// cuts a partially written entry, and the entries of records that start at or
+// past `dataSize`, off the end of the index file of the segment that was last
+// written to. Only the entries that are cut and the ones at either end are read.
+// Nothing is cut if the index file records a format other than `format`
+IndexFileTail RecoverIndexFile(const std::string& filename, std::uint64_t dataSize, const SegmentFormat& format);
+
+// the size of the header at the start of every segment of fixed width
+// records, which holds a magic number, the record size, the record number
+// of the segment's first record and the format of the segment
+constexpr std::size_t FIXED_HEADER_SIZE = 24;
+
+std::string BuildFixedSegmentHeader(std::size_t first, std::uint32_t recordSize, const SegmentFormat& format);
+
+// returns the first record number and the number of complete records in a
+// segment of fixed width records, or a count of 0 if the data file has no
+// header yet. A data file that doesn't start with the header has the format
+// of a segment of variable size records, and no records are counted if the
+// format in the header is for another record size. Throws std::runtime_error
+// if the header has the wrong record size for the format it records
+IndexFileSummary ReadFixedSegmentSummary(const std::string& filename, std::uint32_t recordSize);
+
+// returns the format in the header of a data file of fixed width records, or
+// nothing if it doesn't start with one
+std::optional<SegmentFormat> ReadFixedSegmentFormat(const File& file);
+
+// the size of the fixed part of the footer that ends the data file of a
+// sealed segment, which follows the segment's offset table
+constexpr std::size_t SEGMENT_FOOTER_SIZE = 48;
+
+// the footer of a sealed segment. The data file holds the records in its
+// first `dataSize` bytes, then `tableSize` bytes of index entries, which are
+// compressed unless `compression` is NONE, and then the fixed part
+struct SegmentFooter
+{
+    std::size_t     first = 0;
+    std::size_t     count = 0;
+    std::uint64_t   dataSize = 0;
+    std::uint64_t   tableSize = 0;
+    Compression     compression = Compression::NONE;
+    bool            checksums = false;
+    std::uint32_t   tableCrc = 0;
+};
+
+// returns the footer of a sealed segment for the given index entries, whose
+// records take up the first `dataSize` bytes of its data file
+std::string BuildSegmentFooter(const std::vector<std::size_t>& entries,
+                               std::uint64_t dataSize,
+                               Compression compression,
+                               bool checksums = false);
+
+// returns the footer of a data file of `size` bytes given its last
+// `SEGMENT_FOOTER_SIZE` bytes, or nothing if it doesn't end with a footer
+std::optional<SegmentFooter> ParseSegmentFooter(const char* data, std::uint64_t size);
+
+// reads the footer at the end of a data file, if it has one
+std::optional<SegmentFooter> ReadSegmentFooter(const File& file);
+
+// reads the index entries from the offset table of a sealed segment. Throws
+// std::runtime_error if they don't match the footer's checksum
+std::vector<std::size_t> ReadSegmentFooterEntries(const File& file, const SegmentFooter& footer);
+
+// the size of the CRC32C that follows every record when `Options::checksums`
+// is set, which is part of the record's byte range in the segment's index
+constexpr std::size_t CHECKSUM_SIZE = 4;
+
 template<class ThingT>
 class AshDB final
 {
+    static_assert(!IsRawRecord<ThingT> || std::is_trivially_copyable_v<ThingT>,
+        "only trivially copyable types can be stored as raw records");
 
 public:
     struct Iterator;
@@ -48,7 +201,10 @@ public:
 
     AshDB(const std::string& folder, const Options& options)
         : _dbfolder{ folder },
-          _options{ options }
+          _options{ options },
+          _codec{ options.fixed_record_size == 0 ? GetBlockCodec(options.compression) : nullptr },
+          _appender{ options.write_buffer_size, _codec, options.compression_block_size },
+          _readCache{ options.read_cache_size }
     {
         _startIndex.reset();
         _lastIndex.reset();
@@ -57,17 +213,43 @@ public:
     AshDB(AshDB&& other)
         : AshDB(other._dbfolder, other._options)
     {
+        other.stopFlusher();
+        other.stopSyncThread();
+        other.stopReaper();
         _segmentIndices = std::move(other._segmentIndices);
+        _segmentStarts = std::move(other._segmentStarts);
+        _segmentSizes = std::move(other._segmentSizes);
+        _sealedSize = other._sealedSize;
+        _loadedIndexes = std::move(other._loadedIndexes);
+        _loadedIndexMemory = other._loadedIndexMemory;
         _startIndex = std::move(other._startIndex);
         _lastIndex = std::move(other._lastIndex);
         _startSegmentNumber = std::move(other._startSegmentNumber);
         _activeSegmentNumber = std::move(other._activeSegmentNumber);
+        _appender = std::move(other._appender);
         _open = static_cast<bool>(other._open);
+
+        // blocks cached for `other` belong to the files this database now
+        // reads, `other` gets a generation that matches none of them
+        _blockGeneration = other._blockGeneration;
+        other._blockGeneration = NextBlockGeneration();
+
+        // the sync thread of `other` was stopped above, unlike the flusher
+        // and the reaper it isn't started on demand
+        if (_open && _options.sync_policy == SyncPolicy::INTERVAL)
+        {
+            _syncThread = std::thread{ &AshDB<ThingT>::runSyncThread, this };
+        }
     }
 
     AshDB(const AshDB&) = delete;
 
-    ~AshDB() = default;
+    ~AshDB()
+    {
+        stopFlusher();
+        stopSyncThread();
+        stopReaper();
+    }
 
     OpenStatus open();
     void close();
@@ -75,23 +257,80 @@ public:
     WriteStatus write(const ThingT& thing);
     WriteStatus write(const Batch& batch);
 
+    // queues the record to be written by a background thread, which writes
+    // everything queued so far as a single batch. The result holds the record
+    // number assigned to the record once it has been written. When the queue
+    // is full `Options::async_backpressure` decides what happens
+    std::future<WriteResult> writeAsync(ThingT thing);
+
     ThingT read(std::size_t index) const;
     Batch read(std::size_t index, std::size_t count) const;
 
+    // calls `visitor(index, bytes)` for every record in [begin, end) with the
+    // record's serialized bytes, which point into a memory mapping or a reused
+    // buffer and are only valid during the call. No record is decoded unless
+    // the visitor passes its bytes to `decode`. If the visitor returns a bool
+    // then returning false stops the scan. The visitor must not call back
+    // into the database
+    template<class VisitorT>
+    void scan(std::size_t begin, std::size_t end, VisitorT&& visitor) const;
+
+    // decodes a record from the bytes given to a `scan` visitor
+    static ThingT decode(std::string_view bytes);
+
+    // calls `fn(record)` for every record in [first, last) on the database's
+    // thread pool. The range is split by segment, and big segments into
+    // chunks of `PARALLEL_CHUNK_SIZE` records, which run with at most
+    // `threads` at once (0 uses every worker). `fn` is called from several
+    // threads at a time and must not call back into the database
+    template<class FunctionT>
+    void parallelForEach(std::size_t first, std::size_t last, FunctionT&& fn,
+                         std::size_t threads = 0) const;
+
+    // returns `init` combined with `transform(record)` of every record in
+    // [first, last) using `reduce`, running on the thread pool like
+    // `parallelForEach`. Each chunk is reduced in record order and the
+    // chunks are then combined in order, so the result does not depend on
+    // the number of threads or on how the chunks were scheduled
+    template<class T, class ReduceT, class TransformT>
+    T parallelTransformReduce(std::size_t first, std::size_t last, T init,
+                              ReduceT reduce, TransformT transform,
+                              std::size_t threads = 0) const;
+
+    // the most records of a segment that a single parallel task handles
+    static constexpr std::size_t PARALLEL_CHUNK_SIZE = 16384;
+
     // deletes all records starting at, and includins, `startIndex
     // so that the last index in the database will be `startIndex-1`
     void truncate(std::size_t startIndex);
 
     // returns the accessor boundaries ot the database, for example
     // if we use "db->at(i)", these functions tell us the range of "i"
-    std::optional<std::size_t> startIndex() const { return _startIndex; }
-    std::optional<std::size_t> lastIndex() const { return _lastIndex; }
+    // these share the lock with readers, since writers and the reaper move
+    // the boundaries while records are being read
+    std::optional<std::size_t> startIndex() const
+    {
+        std::shared_lock lock{ _readWriteMutex };
+        return _startIndex;
+    }
+
+    std::optional<std::size_t> lastIndex() const
+    {
+        std::shared_lock lock{ _readWriteMutex };
+        return _lastIndex;
+    }
 
-    bool opened() const noexcept { return _open; }
+    bool opened() const
+    {
+        std::shared_lock lock{ _readWriteMutex };
+        return _open;
+    }
 
     // returns the size of all the "data-0001.dat" files on the disk
     // but does NOT include the size of the corresponding index
-    // files (i.e. "data-0001.datidx")
+    // files (i.e. "data-0001.datidx"), or the footers of sealed segments.
+    // The size is kept up to date as segments are written and deleted, so
+    // this doesn't touch the file system while the active segment is open
     std::uintmax_t databaseSize() const;
 
     // returns the number of records in the database
@@ -116,25 +355,36 @@ public:
         return buildIndexFilename(_activeSegmentNumber);
     }
 
-    // records the vector of vector that keeps track of all the records
-    // and their offsets
-    const SegmentIndices segmentIndices() const
+    // returns a view of the segment indices that keep track of all the
+    // records and their offsets
+    const SegmentIndices& segmentIndices() const
     {
         return _segmentIndices;
     }
 
-    Iterator begin() const noexcept
+    // returns the number of bytes used by the segment indices that are
+    // currently loaded in memory
+    std::size_t indexMemoryUsage() const;
+
+    // the iterators walk the record numbers [startIndex, lastIndex]
+    Iterator begin() const
     {
-        return Iterator{*this};
+        std::shared_lock lock{ _readWriteMutex };
+        return Iterator{*this, _startIndex.value_or(0)};
     }
 
-    Iterator end() const noexcept
+    Iterator end() const
     {
-        return Iterator{*this, this->size()};
+        std::shared_lock lock{ _readWriteMutex };
+        return Iterator{*this, _lastIndex.has_value() ? *_lastIndex + 1 : _startIndex.value_or(0)};
     }
 
 private:
-    // 0 - the segment index (i.e. _segmentIndicies[x]
+    // records are serialized into a `BufferWriter` if their type has the
+    // overloads for it, and otherwise through their `std::ostream` overload
+    using RecordWriter = std::conditional_t<IsBufferSerializable<ThingT>, BufferWriter, RecordBuffer>;
+
+    // 0 - the segment number (i.e. _segmentIndicies[x - _startSegmentNumber])
     // 1 - the index of the offset within the segment index (i.e. _segmentIndicies[x][y])
     using IndexDetails = std::tuple<std::size_t, std::size_t>;
 
@@ -155,13 +405,119 @@ private:
     // cleaning up `_startIndex` and `_lastIndex` as needed
     void updateIndexing();
 
-    // writes the given offset to the current index file and will update
-    // "_segmentIndices" accordingly
-    void writeIndexEntry(std::size_t offset);
+    // returns the value of the index entry for a record written at `offset`
+    // in the active segment. The first entry of each index file is not an
+    // offset but the record number of the first record in that segment
+    std::size_t indexEntry(std::size_t offset) const;
+
+    // the offset of the first record in a data file, which is past the
+    // segment header when using fixed width records
+    std::size_t dataStart() const noexcept;
+
+    // the format that segments are written with under the current options
+    SegmentFormat segmentFormat() const noexcept;
+
+    // creates the index of a new, empty segment
+    SegmentIndex newSegmentIndex() const;
+
+    // the number of bytes taken up by each fixed width record in a data
+    // file, which includes its checksum
+    std::uint32_t fixedSlotSize() const noexcept;
+
+    // writes the checksum of the record in the `size` bytes at `data` to
+    // `buffer`, if checksums are enabled
+    void writeChecksum(RecordWriter& buffer, const char* data, std::size_t size) const;
+
+    // returns the bytes of a record without its checksum given the bytes
+    // stored at `offset` of a segment, verifying the checksum as required by
+    // `Options::verify_checksums`. Throws std::runtime_error if it doesn't match
+    std::string_view recordBytes(std::size_t segment, std::uint64_t offset,
+                                 const char* data, std::size_t size) const;
+
+    // adds the given index entry to "_segmentIndices", starting a new segment
+    // index if the active segment does not have one yet
+    void addIndexEntry(std::size_t value);
+
+    // opens the active segment's files for appending if they aren't already
+    void openAppender();
+
+    // the size of the active segment's data file, 0 if it doesn't exist yet
+    std::uint64_t activeFileSize() const;
+
+    // closes the active segment and moves on to the next one
+    void rolloverSegment();
+
+    // appends the footer to the data file of a segment that is full, after
+    // which its index file is removed
+    void sealSegment(std::uint16_t segment, const std::vector<std::size_t>& entries);
+
+    // turns a sealed segment back into a data file without a footer and an
+    // index file, so that it can be cut short and appended to again
+    void unsealSegment(std::uint16_t segment);
+
+    // returns the footer of a segment's data file, or nothing if the data
+    // file doesn't exist or doesn't end with a footer
+    std::optional<SegmentFooter> segmentFooter(std::uint16_t segment) const;
+
+    // reads the index entries of a sealed segment from the footer of its data
+    // file or, for a segment that was sealed without one, its index file
+    std::vector<std::size_t> readSealedEntries(std::uint16_t segment) const;
+
+    // a record serialized by a writer thread that is waiting for the record
+    // to be committed by the leader of its group
+    struct PendingWrite
+    {
+        const char*         data = nullptr;
+        std::size_t         size = 0;
+        WriteStatus         status = WriteStatus::OK;
+        std::exception_ptr  error;
+        bool                done = false;
+    };
+
+    // a record waiting in the queue of `writeAsync`
+    struct AsyncWrite
+    {
+        ThingT                      thing;
+        std::promise<WriteResult>   promise;
+    };
+
+    // the body of `write(const Batch&)` for the records [begin, end), the
+    // caller must hold the write lock
+    WriteStatus writeBatch(BatchIterator begin, BatchIterator end);
+
+    // run by the flusher thread, which writes the queued records in batches
+    // until it is stopped and the queue has been drained
+    void flushAsyncWrites();
+
+    // writes the records as one batch and fulfills their promises
+    void commitAsyncWrites(std::deque<AsyncWrite>& writes);
+
+    // writes every queued record and then waits for the flusher thread to exit
+    void stopFlusher();
+
+    // syncs the active segment, or wakes the sync thread, as required by
+    // `Options::sync_policy` after records were appended to it. `endOfWrite`
+    // is set once a call to `write` has appended all of its records
+    void syncAppended(bool endOfWrite);
+
+    // run by the sync thread under `SyncPolicy::INTERVAL`, which syncs the
+    // active segment periodically and once more before it exits
+    void runSyncThread();
+
+    void stopSyncThread();
+
+    // appends all the records of a commit group to the active segment with
+    // as few writes as possible, rolling over segments as they fill up
+    void commitGroup(const std::vector<PendingWrite*>& group);
 
     // writes records to the current data file until the begin == end or
-    // until the dat file exceeds the max file size
-    void writeBatchUntilFull(BatchIterator& begin, BatchIterator end);
+    // until the dat file exceeds the max file size. Stops at the first
+    // record that doesn't match `Options::fixed_record_size`
+    WriteStatus writeBatchUntilFull(BatchIterator& begin, BatchIterator end);
+
+    // the same as `writeBatchUntilFull` for raw records, which are appended
+    // straight from the batch without being serialized
+    WriteStatus writeRawBatchUntilFull(BatchIterator& begin, BatchIterator end);
 
     std::string buildDataFilename(std::uint16_t x) const;
     std::string buildIndexFilename(std::uint16_t x) const;
@@ -170,17 +526,188 @@ private:
     // of offset values of the data item's offset in the data file
     IndexDetails findIndexDetails(std::size_t index) const;
 
-    // reset the segment indices and all tracking info
-    void reset();
+    // a cached read handle of a segment's data file, sealed segments are
+    // read through a memory mapping when `Options::mmap_sealed_segments`
+    // is set and all others with positional reads of the file. Both can be
+    // shared by any number of readers since neither has a file position
+    struct SegmentReader
+    {
+        std::shared_ptr<const MappedFile>   mapping;
+        std::shared_ptr<const File>         file;
+
+        // the blocks of a compressed segment, except for the active segment
+        // while it is open for writing since the appender tracks those
+        std::shared_ptr<const BlockTable>   blocks;
+
+        // the size of the records of a segment whose data file ends with
+        // a footer, otherwise the records run to the end of the file
+        std::optional<std::uint64_t>        dataSize;
+    };
+
+    // returns the read handle of the segment's data file from the read cache,
+    // opening the file if it isn't already cached
+    SegmentReader segmentReader(std::uint16_t segment) const;
+
+    // returns the byte range [begin, end) in the data file of the record at
+    // `localIndex` in the segment at `position`
+    std::pair<std::uint64_t, std::uint64_t> recordSpan(const SegmentReader& reader,
+                                                       std::size_t position,
+                                                       std::size_t localIndex) const;
+
+    // copies `size` bytes at `offset` of the segment's data file into `out`,
+    // bytes of the active segment that are still buffered in the appender are
+    // copied from memory. Throws std::runtime_error if the bytes don't exist
+    void copySegmentBytes(std::size_t segment, const SegmentReader& reader,
+                          std::uint64_t offset, char* out, std::size_t size) const;
+
+    // the same as `copySegmentBytes` for the part of a compressed segment
+    // that has been written, which is decompressed one block at a time
+    void copyBlockBytes(std::size_t segment, const SegmentReader& reader,
+                        std::uint64_t offset, char* out, std::size_t size) const;
+
+    // returns the uncompressed bytes of a block of a compressed segment. The
+    // last block decompressed by each thread is kept, so that reading the
+    // records of a block one after the other only decompresses it once
+    const std::vector<char>& blockData(std::size_t segment, const SegmentReader& reader,
+                                       const BlockTable& blocks, std::size_t block) const;
+
+    // returns a pointer to `size` bytes at `offset` of the segment's data file.
+    // Mapped and buffered bytes are returned in place, anything else is read
+    // into `buffer`
+    const char* segmentBytes(std::size_t segment, const SegmentReader& reader,
+                             std::uint64_t offset, std::size_t size,
+                             std::vector<char>& buffer) const;
+
+    // decodes the record stored in the byte range [begin, end) of a segment
+    ThingT readRecord(std::size_t segment, const SegmentReader& reader,
+                      std::uint64_t begin, std::uint64_t end) const;
+
+    // decodes a record that is not a raw record from its serialized bytes
+    static void decodeRecord(const char* data, std::size_t size, ThingT& thing);
+
+    // splits [first, last) into the ranges of records handled by the tasks
+    // of `parallelForEach`, which never span more than one segment
+    std::vector<std::pair<std::size_t, std::size_t>> parallelChunks(std::size_t first,
+                                                                    std::size_t last) const;
+
+    // returns the thread pool, starting it the first time it is used
+    ThreadPool& threadPool() const;
+
+    // calls `visitor(index, bytes)` for `count` records starting at `index`
+    // until it returns false, the bytes of each segment's records are
+    // fetched with a single read. The caller must hold the read lock
+    template<class VisitorT>
+    void visitRecords(std::size_t index, std::size_t count, VisitorT&& visitor) const;
+
+    // drops any cached state of a segment that is about to be deleted
+    void evictSegment(std::uint16_t segment);
+
+    // deletes the oldest segments until the database fits in
+    // `Options::database_max`, which can take more than one segment after a
+    // large batch. The newest segment with records is always kept
+    void trimDatabase();
+
+    // drops the oldest segment from the database and hands its files, and
+    // its read handle, to the reaper thread to be deleted
+    void expireSegment();
+
+    // hands the files of a segment that is no longer part of the database,
+    // and its read handle, to the reaper thread to be deleted
+    void reapSegment(std::uint16_t segment);
+
+    // a segment dropped by `trimDatabase` whose files haven't been deleted yet
+    struct ExpiredSegment
+    {
+        SegmentReader   reader;
+        std::string     datafile;
+        std::string     indexfile;
+    };
+
+    // run by the reaper thread, which deletes the files of expired segments
+    // until it is stopped and every expired segment has been deleted
+    void runReaper();
+
+    // blocks until the files of every expired segment have been deleted
+    void waitForReaper();
+
+    // deletes the files of every expired segment and then waits for the
+    // reaper thread to exit
+    void stopReaper();
+
+    // returns the index of the segment at `position` in `_segmentIndices`,
+    // loading its offsets first if `Options::lazy_index_loading` is set
+    const SegmentIndex& segmentIndex(std::size_t position) const;
+
+    // records that the offsets of a sealed segment are loaded, and unloads
+    // the least recently used indices if the memory budget is exceeded
+    void trackLoadedIndex(std::uint16_t segment) const;
+
+    // reset the segment indices and all tracking info. Returns false if a
+    // segment records a format other than `segmentFormat()`, which is found
+    // before any file is changed and leaves the tracking info as it was
+    bool reset();
+
+    // adds the index of a segment of fixed width records, whose records are
+    // counted from the size of its data file, and the size of a sealed one.
+    // A partially written record at the end of the active segment is cut off.
+    // Returns false, without adding or cutting anything, if the data file
+    // isn't a segment of fixed width records in `segmentFormat()`
+    bool resetFixedSegment(std::uint16_t segment);
+
+    // adds the index of a sealed segment from the footer of its data file
+    // along with the size of its records, if the footer's format is
+    // `segmentFormat()`. Returns the format recorded in the footer, or in the
+    // header of a data file of fixed width records without an index file,
+    // and nothing if the data file doesn't record one
+    std::optional<SegmentFormat> resetSealedSegment(std::uint16_t segment);
+
+    // makes the index file of the segment that was last written to agree
+    // with its data file after a write that never completed. Index entries of
+    // records that aren't in the data file are dropped, the records after the
+    // last one with an entry are re-framed to rebuild their entries and any
+    // partial record is cut off, so only the end of the segment is ever read.
+    // Returns false, without changing any file, if the segment records a
+    // format other than `segmentFormat()`
+    bool recoverSegmentTail(std::uint16_t segment);
+
+    // returns the number of bytes taken up by the record, and its checksum,
+    // at the start of the `size` bytes at `data`, or 0 if they don't start
+    // with a whole record whose checksum matches
+    std::size_t frameRecord(const char* data, std::size_t size) const;
 
     //////////////////////////////////////////////
     // private variables
     std::string       _dbfolder;
     Options           _options;
 
-    // This is a vector of vectors. Each outer vector represents a segment, and the inner
-    // vectors contain the offsets of the data items inside each segment
-    SegmentIndices             _segmentIndices;
+    // compresses the blocks of each segment, nullptr if they aren't compressed
+    const BlockCodec* _codec = nullptr;
+
+    // identifies the current contents of the segment files in the cached
+    // blocks of `blockData`, a new one is taken whenever the files are reloaded.
+    // 0 is never a generation, it marks a database that has nothing cached
+    std::uint64_t     _blockGeneration = 0;
+
+    // Each element represents a segment, and contains the offsets of the data items
+    // inside that segment
+    mutable SegmentIndices      _segmentIndices;
+
+    // the record number of the first record in each segment, this mirrors the
+    // first entry of each vector in `_segmentIndices` but is kept in a single
+    // sorted array so that segment lookups are a binary search
+    std::vector<std::size_t>    _segmentStarts;
+
+    // the size of the data file of each sealed segment in `_segmentIndices`,
+    // without its footer since footers hold the index of their segment and
+    // like index files they aren't part of `databaseSize()`. `_sealedSize`
+    // is the sum of them
+    std::vector<std::uint64_t>  _segmentSizes;
+    std::uint64_t               _sealedSize = 0;
+
+    // the sealed segments whose offsets are loaded when using lazy index
+    // loading, along with the number of bytes used by each of them
+    mutable SegmentCache<std::size_t>   _loadedIndexes{ std::numeric_limits<std::size_t>::max() };
+    mutable std::size_t                 _loadedIndexMemory = 0;
 
     // the index boundaries of the data
     std::optional<std::size_t>  _startIndex = 0;
@@ -190,66 +717,261 @@ private:
     std::uint16_t           _startSegmentNumber = 0;
     std::uint16_t           _activeSegmentNumber = 0;
 
-    mutable std::mutex      _readWriteMutex;
+    // holds the active segment's files open between writes, and buffers the
+    // most recent records in memory when `Options::write_buffer_size` is set
+    SegmentAppender         _appender;
+    RecordWriter            _recordBuffer;
+
+    // open read handles of recently read segments
+    mutable SegmentCache<SegmentReader> _readCache;
+
+    // runs the tasks of the parallel algorithms, started on first use
+    mutable std::mutex                  _threadPoolMutex;
+    mutable std::unique_ptr<ThreadPool> _threadPool;
+
+    // writers hold this exclusively while readers share it, so any number of
+    // reads can run at the same time as long as nothing is being written
+    mutable std::shared_mutex   _readWriteMutex;
+
+    // readers that share `_readWriteMutex` still update the read cache and
+    // the lazily loaded indices, which is guarded by this mutex
+    mutable std::mutex          _cacheMutex;
+
+    // writers that call `write(const ThingT&)` at the same time are committed
+    // together, the first of them becomes the leader and appends the records
+    // of every writer queued behind it while the others wait
+    std::mutex                  _commitMutex;
+    std::condition_variable     _commitCondition;
+    std::vector<PendingWrite*>  _commitQueue;
+    bool                        _commitLeader = false;
+
+    // records queued by `writeAsync` and the thread that writes them, which
+    // is only started the first time a record is queued
+    std::mutex                  _asyncMutex;
+    std::condition_variable     _asyncNotEmpty;
+    std::condition_variable     _asyncNotFull;
+    std::deque<AsyncWrite>      _asyncQueue;
+    std::thread                 _flusher;
+    bool                        _flusherStop = false;
+
+    // the thread that syncs the active segment under `SyncPolicy::INTERVAL`,
+    // writers request an early sync once `Options::sync_bytes` is exceeded
+    std::mutex                  _syncMutex;
+    std::condition_variable     _syncCondition;
+    std::thread                 _syncThread;
+    bool                        _syncRequested = false;
+    bool                        _syncStop = false;
+
+    // the thread that deletes the segments dropped by `Options::database_max`
+    // so that writers never wait for the file system to delete them, which
+    // is only started the first time a segment expires
+    std::mutex                  _reaperMutex;
+    std::condition_variable     _reaperCondition;
+    std::deque<ExpiredSegment>  _expiredSegments;
+    std::thread                 _reaper;
+    bool                        _reaperBusy = false;
+    bool                        _reaperStop = false;
 
     std::atomic_bool        _open = false;
 };
 
+// A random access iterator over the records of the database. Records are
+// read in windows of `Options::read_ahead_window` records as the iterator
+// moves forwards or backwards, so that sequential iteration reads each
+// segment in a few large reads, while a jump (i.e. a step of a binary
+// search) only reads the record it lands on. With
+// `Options::read_ahead_prefetch` the next window is read on a background
+// thread while the current one is used.
+//
+// A reference returned by an iterator is valid until that iterator moves
+// to another window, copies of the iterator keep their own window
 template<class ThingT>
 struct AshDB<ThingT>::Iterator
 {
     friend class AshDB<ThingT>;
 
-    using iterator_category = std::forward_iterator_tag;
-    using difference_type   = std::size_t;
+    using iterator_category = std::random_access_iterator_tag;
+    using difference_type   = std::ptrdiff_t;
     using value_type        = ThingT;
-    using pointer           = value_type*;
-    using reference         = value_type&;
+    using pointer           = const value_type*;
+    using reference         = const value_type&;
 
     Iterator() noexcept = default;
-    Iterator(const Iterator &) noexcept = default;
-    ~Iterator() = default;
+
+    reference operator*() const
+    {
+        assert(_dbptr);
+        if (!_window
+            || _idx < _window->first
+            || _idx >= _window->first + _window->records.size())
+        {
+            load();
+        }
+        return _window->records[_idx - _window->first];
+    }
+
+    pointer operator->() const
+    {
+        return &(**this);
+    }
+
+    value_type operator[](difference_type n) const
+    {
+        return *(*this + n);
+    }
 
     Iterator& operator++()
     {
         _idx++;
         return *this;
     }
-    Iterator operator++(int x)
+
+    Iterator operator++(int)
     {
         auto temp = *this;
         ++(*this);
         return temp;
     }
 
-    reference operator*() const
+    Iterator& operator--()
     {
-        assert(_dbptr);
-        _temp = _dbptr->read(_idx);
-        return _temp;
+        _idx--;
+        return *this;
     }
 
-    pointer operator->() const
+    Iterator operator--(int)
     {
-        assert(_dbptr);
-        _temp = _dbptr->read(_idx);
-        return &_temp;
+        auto temp = *this;
+        --(*this);
+        return temp;
+    }
+
+    Iterator& operator+=(difference_type n)
+    {
+        _idx = static_cast<std::size_t>(static_cast<difference_type>(_idx) + n);
+        return *this;
+    }
+
+    Iterator& operator-=(difference_type n)
+    {
+        return *this += -n;
+    }
+
+    friend Iterator operator+(Iterator it, difference_type n)
+    {
+        return it += n;
+    }
+
+    friend Iterator operator+(difference_type n, Iterator it)
+    {
+        return it += n;
     }
 
-    bool operator!=(const Iterator& rhs) const noexcept
+    friend Iterator operator-(Iterator it, difference_type n)
     {
-        return rhs._idx != _idx;
+        return it -= n;
     }
 
+    friend difference_type operator-(const Iterator& lhs, const Iterator& rhs) noexcept
+    {
+        return static_cast<difference_type>(lhs._idx) - static_cast<difference_type>(rhs._idx);
+    }
+
+    bool operator==(const Iterator& rhs) const noexcept { return _idx == rhs._idx; }
+    bool operator!=(const Iterator& rhs) const noexcept { return _idx != rhs._idx; }
+    bool operator<(const Iterator& rhs) const noexcept { return _idx < rhs._idx; }
+    bool operator>(const Iterator& rhs) const noexcept { return _idx > rhs._idx; }
+    bool operator<=(const Iterator& rhs) const noexcept { return _idx <= rhs._idx; }
+    bool operator>=(const Iterator& rhs) const noexcept { return _idx >= rhs._idx; }
+
 private:
-    Iterator(const AshDB<ThingT>& dbptr, std::size_t idx = 0)
+    // a block of consecutive records starting at record number `first`,
+    // which is never modified once read so it can be shared by copies
+    struct Window
+    {
+        std::size_t first = 0;
+        Batch       records;
+    };
+    using WindowPtr = std::shared_ptr<const Window>;
+
+    Iterator(const AshDB<ThingT>& dbptr, std::size_t idx)
             : _dbptr{&dbptr}, _idx {idx}
     {
     }
 
-    mutable value_type      _temp;
-    const AshDB<ThingT>*    _dbptr = nullptr;
-    std::size_t             _idx = 0;
+    static WindowPtr readWindow(const AshDB<ThingT>* db, std::size_t first, std::size_t count)
+    {
+        return std::make_shared<const Window>(Window{ first, db->read(first, count) });
+    }
+
+    // replaces the window with one that holds `_idx`
+    void load() const
+    {
+        const auto size = std::max<std::size_t>(_dbptr->_options.read_ahead_window, 1);
+        const auto start = _dbptr->startIndex().value_or(0);
+        const auto stop = _dbptr->lastIndex().has_value() ? *(_dbptr->lastIndex()) + 1 : 0;
+
+        const bool forward = !_window || _idx == _window->first + _window->records.size();
+        const bool backward = _window && _idx + 1 == _window->first;
+
+        if (forward && _prefetch.valid())
+        {
+            WindowPtr next;
+            try
+            {
+                next = _prefetch.get();
+            }
+            catch (const std::exception&)
+            {
+                // the window is read again below, which reports the error
+                // if it still fails
+            }
+
+            _prefetch = {};
+            if (next && next->first == _idx && !next->records.empty())
+            {
+                _window = std::move(next);
+                prefetch(stop, size);
+                return;
+            }
+        }
+        _prefetch = {};
+
+        if (forward)
+        {
+            const auto count = _idx < stop ? std::min(size, stop - _idx) : 1;
+            _window = readWindow(_dbptr, _idx, count);
+            prefetch(stop, size);
+        }
+        else if (backward)
+        {
+            const auto first = _idx + 1 > start + size ? _idx + 1 - size : std::min(start, _idx);
+            _window = readWindow(_dbptr, first, _idx + 1 - first);
+        }
+        else
+        {
+            _window = readWindow(_dbptr, _idx, 1);
+        }
+    }
+
+    // starts reading the window that follows the current one
+    void prefetch(std::size_t stop, std::size_t size) const
+    {
+        const auto next = _window->first + _window->records.size();
+        if (!_dbptr->_options.read_ahead_prefetch || next >= stop)
+        {
+            return;
+        }
+
+        _prefetch = std::async(std::launch::async, &Iterator::readWindow,
+                               _dbptr, next, std::min(size, stop - next)).share();
+    }
+
+    const AshDB<ThingT>*                    _dbptr = nullptr;
+    std::size_t                             _idx = 0;
+
+    mutable WindowPtr                       _window;
+    mutable std::shared_future<WindowPtr>   _prefetch;
 };
 
 template<class ThingT>
@@ -291,7 +1013,18 @@ OpenStatus AshDB<ThingT>::open()
         return OpenStatus::EXISTS;
     }
 
-    reset();
+    // the format of each segment is checked as it is loaded, before the
+    // newest one is recovered, since framing its records with the wrong
+    // options would cut them short
+    if (!reset())
+    {
+        return OpenStatus::FORMAT_MISMATCH;
+    }
+
+    if (_options.sync_policy == SyncPolicy::INTERVAL)
+    {
+        _syncThread = std::thread{ &AshDB<ThingT>::runSyncThread, this };
+    }
 
     _open = true;
     return OpenStatus::OK;
@@ -300,7 +1033,16 @@ OpenStatus AshDB<ThingT>::open()
 template<class ThingT>
 void AshDB<ThingT>::close()
 {
+    // anything that was queued before closing is still written and synced,
+    // and every expired segment is deleted
+    stopFlusher();
+    stopSyncThread();
+    stopReaper();
+
     std::scoped_lock lock{_readWriteMutex};
+    _appender.flush();
+    _appender.close();
+    _readCache.clear();
     _startIndex.reset();
     _lastIndex.reset();
     _open = false;
@@ -309,77 +1051,194 @@ void AshDB<ThingT>::close()
 template<class ThingT>
 WriteStatus AshDB<ThingT>::write(const ThingT& thing)
 {
-    std::scoped_lock lock{_readWriteMutex};
-    if (!_open)
+    // whether the database is open is only decided by the leader once it
+    // holds the database lock, since `close()` can run at any point until then.
+    // The record is serialized before joining the queue so that writers
+    // only wait on each other for the append itself
+    PendingWrite pending;
+    if constexpr (IsRawRecord<ThingT>)
     {
-        return WriteStatus::DATABASE_NOT_OPEN;
+        pending.data = reinterpret_cast<const char*>(&thing);
+        pending.size = sizeof(ThingT);
+    }
+    else
+    {
+        thread_local RecordWriter buffer;
+        buffer.clear();
+        ashdb_write(buffer, thing);
+
+        pending.data = buffer.data();
+        pending.size = buffer.size();
     }
 
-    const auto datafile = this->activeDataFile();
-    auto destfilesize = fs::exists(datafile)
-                        ? fs::file_size(datafile.data()) : 0u;
+    std::unique_lock queueLock{ _commitMutex };
+    _commitQueue.push_back(&pending);
+
+    while (!pending.done)
+    {
+        if (_commitLeader)
+        {
+            _commitCondition.wait(queueLock);
+            continue;
+        }
+
+        // become the leader of every record queued so far, including our own
+        _commitLeader = true;
+        std::vector<PendingWrite*> group;
+        group.swap(_commitQueue);
+        queueLock.unlock();
+
+        std::exception_ptr error;
+        try
+        {
+            commitGroup(group);
+        }
+        catch (...)
+        {
+            error = std::current_exception();
+        }
 
-    // write the offset of the current filesize, since this marks the beginning
-    // of *this* record
-    writeIndexEntry(destfilesize);
+        queueLock.lock();
+        for (auto* write : group)
+        {
+            write->error = error;
+            write->done = true;
+        }
 
-    std::ofstream datafs;
-    datafs.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-    datafs.open(datafile.data(), std::ios::out | std::ios::binary | std::ios::app);
-    ashdb_write(datafs, thing);
-    datafs.close();
+        _commitLeader = false;
+        _commitCondition.notify_all();
+    }
 
-    // now that we've written the data, check the filesize once again
-    destfilesize = fs::file_size(datafile.data());
-    updateIndexing();
-    if (_options.filesize_max > 0 && destfilesize >= _options.filesize_max)
+    if (pending.error)
     {
-        _activeSegmentNumber++;
+        std::rethrow_exception(pending.error);
     }
 
-    return WriteStatus::OK;
+    return pending.status;
+}
+
+template<class ThingT>
+void AshDB<ThingT>::commitGroup(const std::vector<PendingWrite*>& group)
+{
+    // every writer in the group fails if the database was closed while
+    // they were queued
+    std::scoped_lock lock{_readWriteMutex};
+    if (!_open)
+    {
+        for (auto* write : group)
+        {
+            write->status = WriteStatus::DATABASE_NOT_OPEN;
+        }
+        return;
+    }
+
+    std::vector<std::size_t> indexBuffer;
+    auto it = group.begin();
+    while (it != group.end())
+    {
+        openAppender();
+
+        _recordBuffer.clear();
+        indexBuffer.clear();
+
+        // combine records until the segment is full, which is the same point
+        // at which a single `write` would have rolled over
+        while (it != group.end())
+        {
+            auto* write = *it++;
+            if (_options.fixed_record_size > 0 && write->size != _options.fixed_record_size)
+            {
+                write->status = WriteStatus::INVALID_RECORD_SIZE;
+                continue;
+            }
+
+            const auto offset = _appender.dataSize() + _recordBuffer.size();
+
+            // only the first record of a segment can be at the start of the data,
+            // and at that point no entries of this group have been added to it yet
+            indexBuffer.push_back(indexEntry(offset));
+            _recordBuffer.write(write->data, static_cast<std::streamsize>(write->size));
+            writeChecksum(_recordBuffer, write->data, write->size);
+
+            if (_options.filesize_max > 0
+                && _appender.storedSize() + _recordBuffer.size() >= _options.filesize_max)
+            {
+                break;
+            }
+        }
+
+        // every record of the group may have been rejected
+        if (!indexBuffer.empty())
+        {
+            _appender.append(_recordBuffer.data(), _recordBuffer.size(), indexBuffer.data(), indexBuffer.size());
+        }
+        syncAppended(it == group.end());
+
+        for (const auto value : indexBuffer)
+        {
+            addIndexEntry(value);
+            updateIndexing();
+        }
+
+        if (_options.filesize_max > 0 && _appender.storedSize() >= _options.filesize_max)
+        {
+            rolloverSegment();
+        }
+    }
 }
 
 template<class ThingT>
-void AshDB<ThingT>::writeBatchUntilFull(BatchIterator& begin, BatchIterator end)
+WriteStatus AshDB<ThingT>::writeBatchUntilFull(BatchIterator& begin, BatchIterator end)
 {
-    const auto datafile = this->activeDataFile();
+    openAppender();
 
     // we have to manually keep track of the file offsets by using the current
     // filesize and the size of the data we're writing
-    const std::size_t startingOffset = fs::exists(datafile) ?
-                                       fs::file_size(datafile) : 0;
+    std::size_t startingOffset = _appender.dataSize();
     std::size_t currentOffset = startingOffset;
 
     // we have two buffers: (1) for the data that we won't flush to disk until
     // we've written as much as we can into this segment, and (2) for the index
     // offsets which we also won't flush until the very end
-    std::stringstream indexBuffer;
-    std::stringstream buffer;
+    std::vector<std::size_t> indexBuffer;
+    RecordWriter& buffer = _recordBuffer;
+    buffer.clear();
 
+    WriteStatus status = WriteStatus::OK;
     while (begin != end)
     {
-        // If the currentOffset == 0 this means this is the first time we're writing to
-        // this segment. The first entry in an index file is not an offset, since it's
-        // unnecessary because we know the corresponding offset is also 0, but instead
-        // is the index number of the first entry in this segment
-        if (currentOffset == 0)
+        // the record is serialized first since it can only be added to the
+        // segment once we know that its size is valid
+        const auto recordStart = buffer.size();
+        ashdb_write(buffer, *begin);
+        if (_options.fixed_record_size > 0
+            && buffer.size() - recordStart != _options.fixed_record_size)
         {
-            if (_segmentIndices.size() > 1)
-            {
-                const auto& secondToLast = _segmentIndices.end()[-2];
+            buffer.truncate(recordStart);
+            status = WriteStatus::INVALID_RECORD_SIZE;
+            break;
+        }
+        writeChecksum(buffer, buffer.data() + recordStart, buffer.size() - recordStart);
+
+        // If the currentOffset is at the start of the data this means this is the first
+        // time we're writing to this segment. The first entry in an index file is not an
+        // offset, since it's unnecessary because we know the corresponding offset, but
+        // instead is the index number of the first entry in this segment
+        std::size_t entry = currentOffset;
+        if (currentOffset == dataStart())
+        {
+            entry = indexEntry(currentOffset);
+        }
 
-                // under these conditions, `currentOffset` actually represents the
-                // index number of the first item in this segment's datafile
-                currentOffset = secondToLast.at(0) + secondToLast.size();
-            }
+        if (_segmentIndices.back().empty())
+        {
+            _segmentStarts.push_back(entry);
         }
 
-        _segmentIndices.back().push_back(currentOffset);
-        indexBuffer.write(reinterpret_cast<char*>(&currentOffset), sizeof(currentOffset));
+        _segmentIndices.back().push_back(entry);
+        indexBuffer.push_back(entry);
 
-        ashdb_write(buffer, *begin);
-        currentOffset = startingOffset + buffer.tellp();
+        currentOffset = startingOffset + buffer.size();
         ++begin;
 
         if (_startIndex.has_value())
@@ -394,394 +1253,2144 @@ void AshDB<ThingT>::writeBatchUntilFull(BatchIterator& begin, BatchIterator end)
             _lastIndex = 0;
         }
 
-        if (_options.filesize_max > 0 &&  currentOffset > _options.filesize_max)
+        // a compressed segment is handed each block's worth of records as
+        // soon as there is one, so that the size limit applies to the
+        // compressed size of everything but the last block
+        if (_codec != nullptr && buffer.size() >= _options.compression_block_size)
+        {
+            _appender.append(buffer.data(), buffer.size(), indexBuffer.data(), indexBuffer.size());
+            syncAppended(false);
+
+            startingOffset = _appender.dataSize();
+            buffer.clear();
+            indexBuffer.clear();
+        }
+
+        if (_options.filesize_max > 0
+            && _appender.storedSize() + buffer.size() > _options.filesize_max)
         {
             break;
         }
     }
 
-    if (buffer.tellp() > 0)
+    if (buffer.size() > 0)
     {
-        assert(indexBuffer.tellp() > 0);
-
-        const std::string indexFile = activeIndexFile();
-        std::ofstream indexfs;
-        indexfs.exceptions(std::ofstream::failbit | std::ofstream::badbit);
-        indexfs.open(indexFile.c_str(), std::ios::out | std::ios::binary | std::ios::app);
-        indexfs << indexBuffer.str();
-        // deepcode ignore MissingOpenCheckOnFile: `indexfs` has exceptions turned on
-        indexfs.close();
-
-        std::ofstream datsafs;
-        datsafs.exceptions(std::ofstream::failbit | std::ofstream::badbit);
-        datsafs.open(datafile.data(), std::ios::out | std::ios::binary | std::ios::app);
-        // deepcode ignore MissingOpenCheckOnFile: `datsafs` has exceptions turned on
-        datsafs << buffer.str();
+        assert(indexBuffer.size() > 0);
+        _appender.append(buffer.data(), buffer.size(), indexBuffer.data(), indexBuffer.size());
+        syncAppended(false);
     }
+
+    return status;
 }
 
 template<class ThingT>
-WriteStatus AshDB<ThingT>::write(const AshDB<ThingT>::Batch& batch)
+WriteStatus AshDB<ThingT>::writeRawBatchUntilFull(BatchIterator& begin, BatchIterator end)
 {
-    std::scoped_lock lock{_readWriteMutex};
-    if (!_open)
+    if (_options.fixed_record_size > 0 && _options.fixed_record_size != sizeof(ThingT))
     {
-        return WriteStatus::DATABASE_NOT_OPEN;
+        return WriteStatus::INVALID_RECORD_SIZE;
     }
 
-    BatchIterator begin = batch.begin();
-    BatchIterator end = batch.end();
+    openAppender();
 
+    // the records of a batch are already laid out exactly as they are
+    // stored, so they are appended straight from the vector and only
+    // the index entries need to be built. With checksums, each record is
+    // copied into the record buffer followed by its checksum instead
+    const std::size_t recordSize = sizeof(ThingT) + (_options.checksums ? CHECKSUM_SIZE : 0);
+    std::vector<std::size_t> indexBuffer;
     while (begin != end)
     {
-        // before we get started, first see if we have to add
-        // another segment index
-        const auto segmentCount = (_activeSegmentNumber - _startSegmentNumber) + 1;
-        if (_segmentIndices.size() == 0
-            || _segmentIndices.size() < segmentCount)
+        const std::size_t startingOffset = _appender.dataSize();
+        auto count = static_cast<std::size_t>(std::distance(begin, end));
+
+        // a compressed segment is filled a block at a time, so that the size
+        // limit applies to the compressed size of the blocks written so far
+        if (_codec != nullptr)
         {
-            assert(_segmentIndices.size() == segmentCount - 1);
-            _segmentIndices.push_back({});
+            count = std::min(count, std::max<std::size_t>(_options.compression_block_size / recordSize, 1));
         }
 
-        // write as much as we can to the current segment
-        writeBatchUntilFull(begin, end);
+        // stop after the record that takes the segment past its size limit
+        const auto storedSize = _appender.storedSize();
+        if (_options.filesize_max > 0)
+        {
+            const auto fit = storedSize <= _options.filesize_max
+                ? static_cast<std::size_t>((_options.filesize_max - storedSize) / recordSize) + 1
+                : 1;
+            count = std::min(count, fit);
+        }
 
-        // in case we stopped writing because the segment file got too big
-        // we need to increment the segment number
-        if ((begin != end) ||
-            (_options.filesize_max > 0 && (fs::file_size(activeDataFile()) > _options.filesize_max)))
+        indexBuffer.resize(count);
+        for (std::size_t i = 0; i < count; ++i)
         {
-            _activeSegmentNumber++;
+            indexBuffer[i] = startingOffset + (i * recordSize);
         }
 
-        // now see if the database is too big and we need to trim it down
-        if (_options.database_max > 0
-            && databaseSize() > _options.database_max)
+        // as in `writeBatchUntilFull`, the first entry of an index file is the
+        // record number of the segment's first record
+        if (startingOffset == dataStart())
         {
-            const auto fn = buildDataFilename(_startSegmentNumber);
-            const auto ifn = buildIndexFilename(_startSegmentNumber);
-            fs::remove(fn);
-            fs::remove(ifn);
+            indexBuffer[0] = indexEntry(startingOffset);
+        }
 
-            _startSegmentNumber++;
-            _segmentIndices.erase(_segmentIndices.begin());
-            _startIndex = _segmentIndices.front().at(0);
+        for (const auto value : indexBuffer)
+        {
+            if (_segmentIndices.back().empty())
+            {
+                _segmentStarts.push_back(value);
+            }
+            _segmentIndices.back().push_back(value);
         }
-    }
 
+        if (_startIndex.has_value())
+        {
+            (*_lastIndex) += count;
+        }
+        else
+        {
+            assert(!_lastIndex.has_value());
+            _startIndex = 0;
+            _lastIndex = count - 1;
+        }
+
+        if (_options.checksums)
+        {
+            _recordBuffer.clear();
+            for (auto it = begin; it != begin + static_cast<std::ptrdiff_t>(count); ++it)
+            {
+                const auto data = reinterpret_cast<const char*>(&*it);
+                _recordBuffer.write(data, static_cast<std::streamsize>(sizeof(ThingT)));
+                writeChecksum(_recordBuffer, data, sizeof(ThingT));
+            }
+            _appender.append(_recordBuffer.data(), _recordBuffer.size(),
+                             indexBuffer.data(), indexBuffer.size());
+        }
+        else
+        {
+            _appender.append(reinterpret_cast<const char*>(&*begin), count * recordSize,
+                             indexBuffer.data(), indexBuffer.size());
+        }
+        syncAppended(false);
+
+        begin += static_cast<std::ptrdiff_t>(count);
+        if (_options.filesize_max > 0 && _appender.storedSize() > _options.filesize_max)
+        {
+            break;
+        }
+    }
+
+    return WriteStatus::OK;
+}
+
+template<class ThingT>
+WriteStatus AshDB<ThingT>::write(const AshDB<ThingT>::Batch& batch)
+{
+    std::scoped_lock lock{_readWriteMutex};
+    if (!_open)
+    {
+        return WriteStatus::DATABASE_NOT_OPEN;
+    }
+
+    return writeBatch(batch.begin(), batch.end());
+}
+
+template<class ThingT>
+WriteStatus AshDB<ThingT>::writeBatch(BatchIterator begin, BatchIterator end)
+{
+    while (begin != end)
+    {
+        // before we get started, first see if we have to add
+        // another segment index
+        const auto segmentCount = (_activeSegmentNumber - _startSegmentNumber) + 1;
+        if (_segmentIndices.size() == 0
+            || _segmentIndices.size() < segmentCount)
+        {
+            assert(_segmentIndices.size() == segmentCount - 1);
+            _segmentIndices.push_back(newSegmentIndex());
+        }
+
+        // write as much as we can to the current segment
+        WriteStatus status = WriteStatus::OK;
+        if constexpr (IsRawRecord<ThingT>)
+        {
+            status = writeRawBatchUntilFull(begin, end);
+        }
+        else
+        {
+            status = writeBatchUntilFull(begin, end);
+        }
+
+        // the records before an invalid one have been written, but the
+        // rest of the batch is not
+        if (status != WriteStatus::OK)
+        {
+            if (_segmentIndices.back().empty())
+            {
+                _segmentIndices.pop_back();
+            }
+
+            syncAppended(true);
+            return status;
+        }
+
+        // in case we stopped writing because the segment file got too big
+        // we need to increment the segment number
+        if ((begin != end) ||
+            (_options.filesize_max > 0 && (_appender.storedSize() > _options.filesize_max)))
+        {
+            rolloverSegment();
+        }
+
+        // now see if the database is too big and we need to trim it down
+        trimDatabase();
+    }
+
+    syncAppended(true);
     return ashdb::WriteStatus::OK;
 }
 
 template<class ThingT>
-ThingT AshDB<ThingT>::read(std::size_t index) const
+std::future<WriteResult> AshDB<ThingT>::writeAsync(ThingT thing)
+{
+    const auto rejected = [](WriteStatus status)
+    {
+        std::promise<WriteResult> promise;
+        promise.set_value(WriteResult{ status, std::nullopt });
+        return promise.get_future();
+    };
+
+    std::unique_lock queueLock{ _asyncMutex };
+    if (!_open || _flusherStop)
+    {
+        return rejected(WriteStatus::DATABASE_NOT_OPEN);
+    }
+
+    const auto capacity = std::max<std::size_t>(_options.async_queue_size, 1);
+    if (_asyncQueue.size() >= capacity)
+    {
+        switch (_options.async_backpressure)
+        {
+            case Backpressure::BLOCK:
+                _asyncNotFull.wait(queueLock, [this, capacity]()
+                {
+                    return _flusherStop || _asyncQueue.size() < capacity;
+                });
+
+                if (_flusherStop)
+                {
+                    return rejected(WriteStatus::DATABASE_NOT_OPEN);
+                }
+                break;
+
+            case Backpressure::FAIL_FAST:
+                return rejected(WriteStatus::QUEUE_FULL);
+
+            case Backpressure::DROP_OLDEST:
+                _asyncQueue.front().promise.set_value(WriteResult{ WriteStatus::DROPPED, std::nullopt });
+                _asyncQueue.pop_front();
+                break;
+        }
+    }
+
+    if (!_flusher.joinable())
+    {
+        _flusher = std::thread{ &AshDB<ThingT>::flushAsyncWrites, this };
+    }
+
+    _asyncQueue.push_back(AsyncWrite{ std::move(thing), std::promise<WriteResult>{} });
+    auto future = _asyncQueue.back().promise.get_future();
+
+    queueLock.unlock();
+    _asyncNotEmpty.notify_one();
+    return future;
+}
+
+template<class ThingT>
+void AshDB<ThingT>::flushAsyncWrites()
+{
+    std::unique_lock queueLock{ _asyncMutex };
+    while (true)
+    {
+        _asyncNotEmpty.wait(queueLock, [this]()
+        {
+            return _flusherStop || !_asyncQueue.empty();
+        });
+
+        // when stopping, exit only once everything has been written
+        if (_asyncQueue.empty())
+        {
+            return;
+        }
+
+        // take everything that is queued so that it is written as one batch
+        std::deque<AsyncWrite> writes;
+        writes.swap(_asyncQueue);
+
+        queueLock.unlock();
+        _asyncNotFull.notify_all();
+
+        commitAsyncWrites(writes);
+
+        queueLock.lock();
+    }
+}
+
+template<class ThingT>
+void AshDB<ThingT>::commitAsyncWrites(std::deque<AsyncWrite>& writes)
+{
+    Batch batch;
+    batch.reserve(writes.size());
+    for (auto& write : writes)
+    {
+        batch.push_back(std::move(write.thing));
+    }
+
+    std::vector<WriteResult> results(batch.size(), WriteResult{ WriteStatus::OK, std::nullopt });
+
+    try
+    {
+        std::scoped_lock lock{_readWriteMutex};
+
+        auto it = batch.cbegin();
+        while (it != batch.cend())
+        {
+            if (!_open)
+            {
+                for (; it != batch.cend(); ++it)
+                {
+                    results[it - batch.cbegin()].status = WriteStatus::DATABASE_NOT_OPEN;
+                }
+                break;
+            }
+
+            // the records of a batch are written one after the other, so
+            // they are numbered consecutively after the last record
+            const auto first = _lastIndex.has_value() ? *_lastIndex + 1 : 0;
+            const auto position = static_cast<std::size_t>(it - batch.cbegin());
+            const auto status = writeBatch(it, batch.cend());
+
+            const auto written = (_lastIndex.has_value() ? *_lastIndex + 1 : 0) - first;
+            for (auto i = 0u; i < written; ++i)
+            {
+                results[position + i].index = first + i;
+            }
+            it += static_cast<std::ptrdiff_t>(written);
+
+            // a record that was rejected on its own doesn't fail the records
+            // queued after it
+            if (status != WriteStatus::OK)
+            {
+                results[position + written].status = status;
+                ++it;
+            }
+        }
+    }
+    catch (...)
+    {
+        for (auto& write : writes)
+        {
+            write.promise.set_exception(std::current_exception());
+        }
+        return;
+    }
+
+    for (auto i = 0u; i < writes.size(); ++i)
+    {
+        writes[i].promise.set_value(results[i]);
+    }
+}
+
+template<class ThingT>
+void AshDB<ThingT>::syncAppended(bool endOfWrite)
+{
+    switch (_options.sync_policy)
+    {
+        case SyncPolicy::NONE:
+            break;
+
+        case SyncPolicy::PER_RECORD:
+            _appender.sync();
+            break;
+
+        case SyncPolicy::PER_BATCH:
+            if (endOfWrite)
+            {
+                _appender.sync();
+            }
+            break;
+
+        case SyncPolicy::INTERVAL:
+            if (_options.sync_bytes > 0 && _appender.unsyncedBytes() >= _options.sync_bytes)
+            {
+                {
+                    std::scoped_lock syncLock{ _syncMutex };
+                    _syncRequested = true;
+                }
+                _syncCondition.notify_one();
+            }
+            break;
+    }
+}
+
+template<class ThingT>
+void AshDB<ThingT>::runSyncThread()
+{
+    const auto ready = [this]() { return _syncStop || _syncRequested; };
+
+    std::unique_lock syncLock{ _syncMutex };
+    while (true)
+    {
+        if (_options.sync_interval.count() > 0)
+        {
+            _syncCondition.wait_for(syncLock, _options.sync_interval, ready);
+        }
+        else
+        {
+            _syncCondition.wait(syncLock, ready);
+        }
+
+        const bool stopping = _syncStop;
+        _syncRequested = false;
+        syncLock.unlock();
+
+        // a shared lock keeps writers from closing or rolling over the
+        // active segment while it is synced, readers are not affected.
+        // Buffered records are written by the sync, which needs the lock
+        // exclusively since readers may be reading them from memory
+        try
+        {
+            if (_options.write_buffer_size > 0 || _codec != nullptr)
+            {
+                std::scoped_lock lock{ _readWriteMutex };
+                _appender.sync();
+            }
+            else
+            {
+                std::shared_lock lock{ _readWriteMutex };
+                _appender.sync();
+            }
+        }
+        catch (const std::exception&)
+        {
+            // nothing can be reported from this thread, the next sync
+            // will try again
+        }
+
+        if (stopping)
+        {
+            return;
+        }
+
+        syncLock.lock();
+    }
+}
+
+template<class ThingT>
+void AshDB<ThingT>::stopSyncThread()
+{
+    if (!_syncThread.joinable())
+    {
+        return;
+    }
+
+    {
+        std::scoped_lock syncLock{ _syncMutex };
+        _syncStop = true;
+    }
+
+    _syncCondition.notify_all();
+    _syncThread.join();
+
+    std::scoped_lock syncLock{ _syncMutex };
+    _syncStop = false;
+    _syncRequested = false;
+}
+
+template<class ThingT>
+void AshDB<ThingT>::stopFlusher()
+{
+    {
+        std::scoped_lock queueLock{ _asyncMutex };
+        if (!_flusher.joinable())
+        {
+            return;
+        }
+        _flusherStop = true;
+    }
+
+    _asyncNotEmpty.notify_all();
+    _asyncNotFull.notify_all();
+    _flusher.join();
+
+    std::scoped_lock queueLock{ _asyncMutex };
+    _flusherStop = false;
+}
+
+template<class ThingT>
+ThingT AshDB<ThingT>::read(std::size_t index) const
+{
+    std::shared_lock lock{_readWriteMutex};
+
+    auto [currentSegment, localIndex] = findIndexDetails(index);
+    const auto reader = segmentReader(static_cast<std::uint16_t>(currentSegment));
+    const auto [begin, end] = recordSpan(reader, currentSegment - _startSegmentNumber, localIndex);
+
+    return readRecord(currentSegment, reader, begin, end);
+}
+
+template<class ThingT>
+auto AshDB<ThingT>::read(std::size_t index, std::size_t count) const -> AshDB<ThingT>::Batch
+{
+    std::shared_lock lock{_readWriteMutex};
+
+    AshDB<ThingT>::Batch batch;
+    if (count == 0)
+    {
+        return batch;
+    }
+
+    if constexpr (!IsRawRecord<ThingT>)
+    {
+        batch.reserve(count);
+        visitRecords(index, count, [&batch](std::size_t, std::string_view bytes)
+        {
+            batch.emplace_back();
+            decodeRecord(bytes.data(), bytes.size(), batch.back());
+            return true;
+        });
+    }
+    else if (_options.checksums)
+    {
+        // each record has to be checked on its own
+        batch.reserve(count);
+        visitRecords(index, count, [&batch](std::size_t, std::string_view bytes)
+        {
+            batch.push_back(decode(bytes));
+            return true;
+        });
+    }
+    else
+    {
+        const auto endIndex = index + count;
+        auto [segment, offsetIndex] = findIndexDetails(index);
+        findIndexDetails(endIndex - 1); // throws if the range is out of bounds
+
+        batch.resize(count);
+        for (auto i = index; i < (index + count);)
+        {
+            const auto position = segment - _startSegmentNumber;
+            const auto segmentStart = _segmentStarts[position];
+            auto localMax = _segmentIndices[position].size();
+            if (endIndex <= (segmentStart + localMax))
+            {
+                localMax = endIndex - segmentStart;
+            }
+
+            const auto reader = segmentReader(static_cast<std::uint16_t>(segment));
+
+            // raw records are stored back to back, so all of them are copied
+            // straight into the batch with a single read
+            const auto records = localMax - offsetIndex;
+            const auto first = recordSpan(reader, position, offsetIndex).first;
+            const auto last = recordSpan(reader, position, localMax - 1).first;
+            if (last != first + ((records - 1) * sizeof(ThingT)))
+            {
+                std::stringstream ss;
+                ss << "records of segment " << segment << " are not stored as raw records";
+                throw std::runtime_error(ss.str());
+            }
+
+            copySegmentBytes(segment, reader, first,
+                             reinterpret_cast<char*>(batch.data() + (i - index)),
+                             records * sizeof(ThingT));
+            i += records;
+
+            offsetIndex = 0;
+            segment++;
+        }
+    }
+
+    return batch;
+}
+
+template<class ThingT>
+template<class VisitorT>
+void AshDB<ThingT>::scan(std::size_t begin, std::size_t end, VisitorT&& visitor) const
+{
+    std::shared_lock lock{_readWriteMutex};
+    if (begin >= end)
+    {
+        return;
+    }
+
+    visitRecords(begin, end - begin, [&visitor](std::size_t index, std::string_view bytes)
+    {
+        if constexpr (std::is_same_v<std::invoke_result_t<VisitorT&, std::size_t, std::string_view>, bool>)
+        {
+            return visitor(index, bytes);
+        }
+        else
+        {
+            visitor(index, bytes);
+            return true;
+        }
+    });
+}
+
+template<class ThingT>
+ThingT AshDB<ThingT>::decode(std::string_view bytes)
+{
+    ThingT thing;
+    if constexpr (IsRawRecord<ThingT>)
+    {
+        if (bytes.size() < sizeof(ThingT))
+        {
+            throw std::runtime_error("record is smaller than a raw record");
+        }
+        std::memcpy(&thing, bytes.data(), sizeof(ThingT));
+    }
+    else
+    {
+        decodeRecord(bytes.data(), bytes.size(), thing);
+    }
+    return thing;
+}
+
+template<class ThingT>
+template<class FunctionT>
+void AshDB<ThingT>::parallelForEach(std::size_t first, std::size_t last, FunctionT&& fn,
+                                    std::size_t threads) const
+{
+    std::shared_lock lock{_readWriteMutex};
+    if (first >= last)
+    {
+        return;
+    }
+
+    const auto chunks = parallelChunks(first, last);
+    threadPool().forEach(chunks.size(), threads, [this, &chunks, &fn](std::size_t chunk)
+    {
+        const auto [begin, end] = chunks[chunk];
+        visitRecords(begin, end - begin, [&fn](std::size_t, std::string_view bytes)
+        {
+            fn(decode(bytes));
+            return true;
+        });
+    });
+}
+
+template<class ThingT>
+template<class T, class ReduceT, class TransformT>
+T AshDB<ThingT>::parallelTransformReduce(std::size_t first, std::size_t last, T init,
+                                         ReduceT reduce, TransformT transform,
+                                         std::size_t threads) const
+{
+    std::shared_lock lock{_readWriteMutex};
+    if (first >= last)
+    {
+        return init;
+    }
+
+    const auto chunks = parallelChunks(first, last);
+    std::vector<std::optional<T>> partials(chunks.size());
+
+    threadPool().forEach(chunks.size(), threads,
+        [this, &chunks, &partials, &reduce, &transform](std::size_t chunk)
+    {
+        std::optional<T> partial;
+        const auto [begin, end] = chunks[chunk];
+        visitRecords(begin, end - begin, [&partial, &reduce, &transform](std::size_t, std::string_view bytes)
+        {
+            T value = transform(decode(bytes));
+            if (partial.has_value())
+            {
+                partial = reduce(std::move(*partial), std::move(value));
+            }
+            else
+            {
+                partial = std::move(value);
+            }
+            return true;
+        });
+        partials[chunk] = std::move(partial);
+    });
+
+    T result = std::move(init);
+    for (auto& partial : partials)
+    {
+        if (partial.has_value())
+        {
+            result = reduce(std::move(result), std::move(*partial));
+        }
+    }
+    return result;
+}
+
+template<class ThingT>
+std::vector<std::pair<std::size_t, std::size_t>> AshDB<ThingT>::parallelChunks(std::size_t first,
+                                                                               std::size_t last) const
+{
+    // throws if the range is out of bounds
+    findIndexDetails(first);
+    findIndexDetails(last - 1);
+
+    std::vector<std::pair<std::size_t, std::size_t>> chunks;
+    for (auto position = 0u; position < _segmentStarts.size(); ++position)
+    {
+        const auto segmentStart = _segmentStarts[position];
+        const auto segmentEnd = segmentStart + _segmentIndices[position].size();
+        const auto begin = std::max(first, segmentStart);
+        const auto end = std::min(last, segmentEnd);
+
+        for (auto chunk = begin; chunk < end; chunk += PARALLEL_CHUNK_SIZE)
+        {
+            chunks.emplace_back(chunk, std::min(chunk + PARALLEL_CHUNK_SIZE, end));
+        }
+    }
+
+    return chunks;
+}
+
+template<class ThingT>
+ThreadPool& AshDB<ThingT>::threadPool() const
+{
+    std::scoped_lock lock{_threadPoolMutex};
+    if (!_threadPool)
+    {
+        _threadPool = std::make_unique<ThreadPool>(_options.worker_threads);
+    }
+    return *_threadPool;
+}
+
+template<class ThingT>
+template<class VisitorT>
+void AshDB<ThingT>::visitRecords(std::size_t index, std::size_t count, VisitorT&& visitor) const
+{
+    const auto endIndex = index + count;
+    auto [segment, offsetIndex] = findIndexDetails(index);
+    findIndexDetails(endIndex - 1); // throws if the range is out of bounds
+
+    for (auto i = index; i < endIndex;)
+    {
+        const auto position = segment - _startSegmentNumber;
+        const auto segmentStart = _segmentStarts[position];
+        auto localMax = _segmentIndices[position].size();
+        if (endIndex <= (segmentStart + localMax))
+        {
+            localMax = endIndex - segmentStart;
+        }
+
+        const auto reader = segmentReader(static_cast<std::uint16_t>(segment));
+
+        // the records of a segment are contiguous, so the bytes of all of
+        // them are fetched with one read (or none if they are mapped or
+        // buffered) and then handed out one after the other
+        thread_local std::vector<char> buffer;
+        const auto first = recordSpan(reader, position, offsetIndex).first;
+        const auto last = recordSpan(reader, position, localMax - 1).second;
+        if (last < first)
+        {
+            std::stringstream ss;
+            ss << "records of segment " << segment << " have invalid offsets";
+            throw std::runtime_error(ss.str());
+        }
+
+        const auto data = segmentBytes(segment, reader, first,
+                                       static_cast<std::size_t>(last - first), buffer);
+
+        for (; offsetIndex < localMax; ++i, ++offsetIndex)
+        {
+            const auto [begin, end] = recordSpan(reader, position, offsetIndex);
+            if (begin < first || end < begin || end > last)
+            {
+                std::stringstream ss;
+                ss << "record at offset " << begin << " has an invalid size";
+                throw std::runtime_error(ss.str());
+            }
+
+            const auto bytes = recordBytes(segment, begin, data + (begin - first),
+                                           static_cast<std::size_t>(end - begin));
+            if (!visitor(i, bytes))
+            {
+                return;
+            }
+        }
+
+        offsetIndex = 0;
+        segment++;
+    }
+}
+
+template<class ThingT>
+void AshDB<ThingT>::truncate(std::size_t startIndex)
+{
+    std::scoped_lock lock{_readWriteMutex};
+
+    auto [currentSegment, localIndex] = findIndexDetails(startIndex);
+
+    // release every handle to the files that are about to be modified, after
+    // writing any buffered records since they may be part of what is kept
+    _appender.flush();
+    _appender.close();
+    _readCache.clear();
+
+    if (localIndex > 0)
+    {
+        // the segment that is cut short becomes the active segment, which has
+        // an index file rather than a footer
+        const auto& index = segmentIndex(currentSegment - _startSegmentNumber);
+        const auto offset = index.offset(localIndex);
+        const auto dropped = index.size() - localIndex;
+        if (_options.fixed_record_size == 0)
+        {
+            unsealSegment(static_cast<std::uint16_t>(currentSegment));
+        }
+
+        // trim the data file, the offsets of a compressed segment are offsets
+        // into its uncompressed records
+        const auto datafile { buildDataFilename(currentSegment) };
+        if (_codec != nullptr)
+        {
+            TruncateBlocks(datafile, offset, *_codec);
+        }
+        else
+        {
+            fs::resize_file(datafile.c_str(), offset);
+        }
+
+        // trim the index file
+        if (_options.fixed_record_size == 0)
+        {
+            const auto indexfile { buildIndexFilename(currentSegment) };
+            fs::resize_file(indexfile.c_str(), fs::file_size(indexfile) - (dropped * sizeof(std::size_t)));
+        }
+
+        // start deleting segment files at the next segment
+        currentSegment++;
+    }
+
+    // delete all excess segment and index files
+    while (currentSegment <= _activeSegmentNumber)
+    {
+        const auto datafile { buildDataFilename(currentSegment) };
+        fs::remove(datafile.c_str());
+
+        const auto indexfile { buildIndexFilename(currentSegment) };
+        fs::remove(indexfile.c_str());
+
+        currentSegment++;
+    }
+
+    reset();
+}
+
+template<class ThingT>
+bool AshDB<ThingT>::reset()
+{
+    // the files of expired segments would otherwise be found again
+    waitForReaper();
+
+    _appender.close();
+    _readCache.clear();
+    _blockGeneration = NextBlockGeneration();
+
+    // the segments are loaded in place of the current ones, which are put
+    // back if one of them turns out to be in another format
+    const auto startSegment = _startSegmentNumber;
+    const auto activeSegment = _activeSegmentNumber;
+    auto segmentIndices = std::exchange(_segmentIndices, {});
+    auto segmentStarts = std::exchange(_segmentStarts, {});
+    auto segmentSizes = std::exchange(_segmentSizes, {});
+    SegmentCache<std::size_t> loadedIndexes{ _loadedIndexes.capacity() };
+    std::swap(loadedIndexes, _loadedIndexes);
+    const auto loadedIndexMemory = std::exchange(_loadedIndexMemory, 0);
+
+    const auto rejected = [&]
+    {
+        _startSegmentNumber = startSegment;
+        _activeSegmentNumber = activeSegment;
+        _segmentIndices = std::move(segmentIndices);
+        _segmentStarts = std::move(segmentStarts);
+        _segmentSizes = std::move(segmentSizes);
+        _loadedIndexes = std::move(loadedIndexes);
+        _loadedIndexMemory = loadedIndexMemory;
+        return false;
+    };
+
+    findFileBoundaries();
+    const auto firstSegment = _startSegmentNumber;
+    const auto format = segmentFormat();
+
+    // segments of fixed width records have their tail checked as they are
+    // loaded. Otherwise the segment that was last written to is the active
+    // segment, or the one before it if it was full, and it is recovered once
+    // every segment before it has been checked
+    const auto newest = static_cast<std::uint16_t>(_options.fixed_record_size == 0
+            && _activeSegmentNumber > _startSegmentNumber
+            && !fs::exists(buildDataFilename(_activeSegmentNumber))
+        ? _activeSegmentNumber - 1
+        : _activeSegmentNumber);
+
+    // load the record-index
+    for (auto i = _startSegmentNumber; i <= _activeSegmentNumber; ++i)
+    {
+        // segments without any records ahead of the first one that has some
+        // are left out, so the first segment index is that of the segment at
+        // `_startSegmentNumber`, and are deleted once every segment is loaded
+        if (_segmentIndices.empty())
+        {
+            _startSegmentNumber = i;
+        }
+
+        if (_options.fixed_record_size > 0)
+        {
+            if (!resetFixedSegment(i))
+            {
+                return rejected();
+            }
+            continue;
+        }
+
+        if (i == newest)
+        {
+            if (!recoverSegmentTail(i))
+            {
+                return rejected();
+            }
+
+            // a segment that filled up but was never sealed, because the
+            // process died before the next write rolled it over
+            if (newest < _activeSegmentNumber && !segmentFooter(newest))
+            {
+                if (const auto entries = ashdb::ReadIndexFile(buildIndexFilename(newest)); !entries.empty())
+                {
+                    sealSegment(newest, entries);
+                }
+            }
+        }
+
+        if (i < _activeSegmentNumber)
+        {
+            if (const auto sealed = resetSealedSegment(i); sealed.has_value())
+            {
+                if (*sealed != format)
+                {
+                    return rejected();
+                }
+                continue;
+            }
+        }
+
+        // skip segments without a complete first entry, i.e. when the
+        // files were created but the first write never made it to disk
+        const auto indexFilename = buildIndexFilename(i);
+        if (!fs::exists(indexFilename))
+        {
+            continue;
+        }
+
+        const auto summary = ashdb::ReadIndexFileSummary(indexFilename);
+        if (summary.format.has_value() && *summary.format != format)
+        {
+            return rejected();
+        }
+        else if (summary.count == 0)
+        {
+            continue;
+        }
+
+        if (_options.lazy_index_loading && i < _activeSegmentNumber)
+        {
+            // only the active segment's offsets are needed to start writing,
+            // every other segment is loaded the first time it is read
+            _segmentIndices.push_back(
+                SegmentIndex::Unloaded(summary.first, summary.count, _options.index_encoding));
+        }
+        else
+        {
+            _segmentIndices.emplace_back(ashdb::ReadIndexFile(indexFilename), _options.index_encoding);
+            if (i < _activeSegmentNumber)
+            {
+                _segmentIndices.back().seal();
+            }
+        }
+
+        // `_segmentSizes` has an entry for every sealed segment that has an
+        // index, so that expiring a segment drops both of them together
+        if (i < _activeSegmentNumber)
+        {
+            _segmentSizes.push_back(fs::file_size(buildDataFilename(i)));
+        }
+        _segmentStarts.push_back(_segmentIndices.back().at(0));
+    }
+
+    // the files of the segments that were left out would otherwise stay on
+    // disk outside of `databaseSize()` and the retention of `Options::database_max`
+    for (auto segment = firstSegment; segment < _startSegmentNumber; ++segment)
+    {
+        reapSegment(segment);
+    }
+
+    _sealedSize = std::accumulate(_segmentSizes.begin(), _segmentSizes.end(), std::uint64_t{ 0 });
+    findIndexBoundaries();
+    return true;
+}
+
+template<class ThingT>
+bool AshDB<ThingT>::resetFixedSegment(std::uint16_t segment)
+{
+    const auto datafile = buildDataFilename(segment);
+    const auto recordSize = fixedSlotSize();
+    const auto summary = ashdb::ReadFixedSegmentSummary(datafile, recordSize);
+    if (summary.format.has_value() && *summary.format != segmentFormat())
+    {
+        return false;
+    }
+
+    // only the active segment can end in the middle of a record, which is
+    // what is left of a write that never completed
+    if (segment == _activeSegmentNumber && fs::exists(datafile))
+    {
+        const auto expected = summary.count > 0 || fs::file_size(datafile) >= FIXED_HEADER_SIZE
+            ? FIXED_HEADER_SIZE + (summary.count * recordSize)
+            : 0;
+        if (fs::file_size(datafile) != expected)
+        {
+            fs::resize_file(datafile, expected);
+        }
+    }
+
+    if (summary.count == 0)
+    {
+        return true;
+    }
+
+    _segmentIndices.push_back(
+        SegmentIndex::Fixed(summary.first, summary.count, FIXED_HEADER_SIZE, recordSize));
+    _segmentStarts.push_back(summary.first);
+    if (segment < _activeSegmentNumber)
+    {
+        _segmentSizes.push_back(fs::file_size(datafile));
+    }
+    return true;
+}
+
+template<class ThingT>
+std::optional<SegmentFormat> AshDB<ThingT>::resetSealedSegment(std::uint16_t segment)
+{
+    // every segment before the active segment has a data file, since
+    // `findFileBoundaries` only uses a contiguous run of segments
+    const File file{ buildDataFilename(segment), File::Mode::Read };
+    const auto footer = ashdb::ReadSegmentFooter(file);
+    if (!footer.has_value())
+    {
+        // a segment without a footer is read through its index file, and
+        // one without either can be a segment of fixed width records
+        if (fs::exists(buildIndexFilename(segment)))
+        {
+            return std::nullopt;
+        }
+        return ashdb::ReadFixedSegmentFormat(file);
+    }
+
+    const SegmentFormat format{ footer->compression, footer->checksums };
+    if (format != segmentFormat())
+    {
+        return format;
+    }
+
+    if (_options.lazy_index_loading)
+    {
+        _segmentIndices.push_back(SegmentIndex::Unloaded(footer->first, footer->count, _options.index_encoding));
+    }
+    else
+    {
+        _segmentIndices.emplace_back(ashdb::ReadSegmentFooterEntries(file, *footer), _options.index_encoding);
+        _segmentIndices.back().seal();
+    }
+
+    _segmentStarts.push_back(footer->first);
+    _segmentSizes.push_back(footer->dataSize);
+    return format;
+}
+
+template<class ThingT>
+bool AshDB<ThingT>::recoverSegmentTail(std::uint16_t segment)
+{
+    const auto datafile = buildDataFilename(segment);
+    const auto indexfile = buildIndexFilename(segment);
+    if (!fs::exists(datafile))
+    {
+        return true;
+    }
+
+    // a sealed segment was complete before its footer was written, which
+    // leaves at most its index file to be removed
+    const auto format = segmentFormat();
+    if (const auto footer = segmentFooter(segment); footer.has_value())
+    {
+        if (SegmentFormat{ footer->compression, footer->checksums } != format)
+        {
+            return false;
+        }
+
+        fs::remove(indexfile);
+        return true;
+    }
+
+    // a reader of its own since the read cache is only filled once the
+    // files can be trusted. A compressed segment ends at its last whole block
+    SegmentReader reader;
+    reader.file = std::make_shared<const File>(datafile, File::Mode::Read);
+    if (!fs::exists(indexfile))
+    {
+        // a data file without an index file can be a segment of fixed width records
+        if (const auto fixed = ashdb::ReadFixedSegmentFormat(*reader.file); fixed.has_value() && *fixed != format)
+        {
+            return false;
+        }
+    }
+
+    if (_codec != nullptr)
+    {
+        reader.blocks = std::make_shared<const BlockTable>(ReadBlockTable(*reader.file));
+    }
+    const auto dataSize = reader.blocks ? reader.blocks->rawSize() : reader.file->size();
+
+    const auto tail = ashdb::RecoverIndexFile(indexfile, dataSize, format);
+    if (tail.format.has_value() && *tail.format != format)
+    {
+        return false;
+    }
+
+    // the first record of a segment without any entries follows the last
+    // record of the segment before it. Without one the record number is
+    // unknown and the records are dropped
+    std::optional<std::size_t> first;
+    if (tail.count > 0)
+    {
+        first = tail.first;
+    }
+    else if (segment > _startSegmentNumber)
+    {
+        const auto previousSegment = static_cast<std::uint16_t>(segment - 1);
+        IndexFileSummary previous;
+        if (const auto footer = segmentFooter(previousSegment); footer.has_value())
+        {
+            previous = { footer->first, footer->count };
+        }
+        else if (fs::exists(buildIndexFilename(previousSegment)))
+        {
+            previous = ashdb::ReadIndexFileSummary(buildIndexFilename(previousSegment));
+        }
+
+        if (previous.count > 0)
+        {
+            first = previous.first + previous.count;
+        }
+    }
+
+    // the end of the last record with an entry isn't recorded anywhere, so
+    // the re-framing starts with it rather than after it
+    const std::uint64_t start = tail.count > 0 ? tail.lastOffset : dataStart();
+    std::uint64_t end = start;
+    std::vector<std::size_t> entries;
+    if (first.has_value() && dataSize > start)
+    {
+        std::vector<char> bytes(static_cast<std::size_t>(dataSize - start));
+        copySegmentBytes(segment, reader, start, bytes.data(), bytes.size());
+
+        for (std::size_t position = 0; position < bytes.size();)
+        {
+            const auto size = frameRecord(bytes.data() + position, bytes.size() - position);
+            if (size == 0)
+            {
+                break;
+            }
+
+            if (position > 0 || tail.count == 0)
+            {
+                entries.push_back(start + position == dataStart() ? *first : start + position);
+            }
+
+            position += size;
+            end = start + position;
+        }
+    }
+    reader = {};
+
+    // a last record with an entry that isn't whole loses its entry as well
+    auto keptCount = tail.count;
+    if (keptCount > 0 && end == start)
+    {
+        --keptCount;
+        fs::resize_file(indexfile, fs::file_size(indexfile) - sizeof(std::size_t));
+    }
+
+    if (end < dataSize)
+    {
+        if (_codec != nullptr)
+        {
+            TruncateBlocks(datafile, end, *_codec);
+            _blockGeneration = NextBlockGeneration();
+        }
+        else
+        {
+            fs::resize_file(datafile, end);
+        }
+    }
+
+    if (!entries.empty())
+    {
+        const auto created = !fs::exists(indexfile) || fs::file_size(indexfile) == 0;
+        File index{ indexfile, File::Mode::Append };
+        if (created)
+        {
+            const auto header = BuildIndexFileHeader(format);
+            index.write(header.data(), header.size());
+        }
+        index.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(std::size_t));
+    }
+
+    return true;
+}
+
+template<class ThingT>
+std::size_t AshDB<ThingT>::frameRecord(const char* data, std::size_t size) const
+{
+    // a record is framed by decoding it, which fails if it was cut short
+    std::size_t recordSize = 0;
+    try
+    {
+        ThingT thing;
+        if constexpr (IsRawRecord<ThingT>)
+        {
+            recordSize = sizeof(ThingT);
+        }
+        else if constexpr (IsBufferSerializable<ThingT>)
+        {
+            BufferReader bytes{ data, size };
+            ashdb_read(bytes, thing);
+            recordSize = size - bytes.remaining();
+        }
+        else
+        {
+            MemoryStream stream{ data, size };
+            stream.exceptions(std::ios_base::badbit | std::ios_base::failbit);
+            ashdb_read(stream, thing);
+            recordSize = static_cast<std::size_t>(
+                stream.rdbuf()->pubseekoff(0, std::ios_base::cur, std::ios_base::in));
+        }
+    }
+    catch (const std::exception&)
+    {
+        return 0;
+    }
+
+    if (recordSize == 0 || recordSize > size)
+    {
+        return 0;
+    }
+
+    if (_options.checksums)
+    {
+        std::uint32_t crc = 0;
+        if (size - recordSize < CHECKSUM_SIZE)
+        {
+            return 0;
+        }
+
+        std::memcpy(&crc, data + recordSize, sizeof(crc));
+        if (Crc32c(data, recordSize) != crc)
+        {
+            return 0;
+        }
+        recordSize += CHECKSUM_SIZE;
+    }
+
+    return recordSize;
+}
+
+template<class ThingT>
+void AshDB<ThingT>::findFileBoundaries()
+{
+    const auto segments = ashdb::FindSegmentNumbers(_dbfolder, _options.prefix, _options.extension);
+
+    _startSegmentNumber = 0;
+    _activeSegmentNumber = 0;
+
+    if (segments.empty())
+    {
+        return;
+    }
+
+    // the segments must be contiguous, so if there is a gap in the numbering
+    // then the newest run of segments is used and anything older is ignored
+    auto first = segments.rbegin();
+    while (std::next(first) != segments.rend() && *std::next(first) + 1 == *first)
+    {
+        ++first;
+    }
+
+    _startSegmentNumber = *first;
+    _activeSegmentNumber = segments.back();
+
+    // the newest segment is only appended to if it isn't full or sealed,
+    // since a segment can be sealed before it is full when the next
+    // record didn't fit in it
+    if (const auto datafile = activeDataFile(); fs::exists(datafile.data()))
+    {
+        if ((_options.filesize_max != 0 && fs::file_size(datafile.data()) >= _options.filesize_max)
+            || (_options.fixed_record_size == 0 && segmentFooter(_activeSegmentNumber).has_value()))
+        {
+            _activeSegmentNumber++;
+        }
+    }
+}
+
+template<class ThingT>
+void AshDB<ThingT>::findIndexBoundaries()
+{
+    _startIndex.reset();
+    _lastIndex.reset();
+
+    // load the accessor boundaries
+    if (_segmentIndices.size() > 0)
+    {
+        assert(_segmentIndices.front().size() > 0);
+        _startIndex = _segmentIndices.front().at(0);
+
+        assert(_segmentIndices.back().size() > 0);
+        _lastIndex = _segmentIndices.back().front() + (_segmentIndices.back().size() - 1);
+    }
+}
+
+template<class ThingT>
+void AshDB<ThingT>::updateIndexing()
+{
+    if (!_startIndex.has_value())
+    {
+        assert(!_lastIndex.has_value());
+        _startIndex = 0;
+        _lastIndex = 0;
+    }
+    else
+    {
+        (*_lastIndex)++;
+    }
+
+    // now see if the database is too big and we need to trim it down
+    trimDatabase();
+}
+
+template<class ThingT>
+std::size_t AshDB<ThingT>::indexEntry(std::size_t offset) const
+{
+    // records are numbered consecutively across segments, so the first
+    // record of a segment follows the last record of the database
+    if (offset == dataStart())
+    {
+        return _lastIndex.has_value() ? *_lastIndex + 1 : 0;
+    }
+
+    return offset;
+}
+
+template<class ThingT>
+std::size_t AshDB<ThingT>::dataStart() const noexcept
+{
+    return _options.fixed_record_size > 0 ? FIXED_HEADER_SIZE : 0;
+}
+
+template<class ThingT>
+SegmentFormat AshDB<ThingT>::segmentFormat() const noexcept
+{
+    SegmentFormat format;
+    format.compression = _codec != nullptr ? _options.compression : Compression::NONE;
+    format.checksums = _options.checksums;
+    format.fixedRecordSize = _options.fixed_record_size;
+    return format;
+}
+
+template<class ThingT>
+SegmentIndex AshDB<ThingT>::newSegmentIndex() const
+{
+    if (_options.fixed_record_size > 0)
+    {
+        return SegmentIndex::Fixed(0, 0, FIXED_HEADER_SIZE, fixedSlotSize());
+    }
+
+    return SegmentIndex{ _options.index_encoding };
+}
+
+template<class ThingT>
+std::uint32_t AshDB<ThingT>::fixedSlotSize() const noexcept
+{
+    return _options.fixed_record_size + (_options.checksums ? static_cast<std::uint32_t>(CHECKSUM_SIZE) : 0);
+}
+
+template<class ThingT>
+void AshDB<ThingT>::writeChecksum(RecordWriter& buffer, const char* data, std::size_t size) const
+{
+    if (_options.checksums)
+    {
+        const auto crc = Crc32c(data, size);
+        buffer.write(reinterpret_cast<const char*>(&crc), static_cast<std::streamsize>(sizeof(crc)));
+    }
+}
+
+template<class ThingT>
+std::string_view AshDB<ThingT>::recordBytes(std::size_t segment, std::uint64_t offset,
+                                            const char* data, std::size_t size) const
+{
+    if (!_options.checksums)
+    {
+        return { data, size };
+    }
+
+    if (size < CHECKSUM_SIZE)
+    {
+        std::stringstream ss;
+        ss << "record at offset " << offset << " of segment " << segment << " is too small to have a checksum";
+        throw std::runtime_error(ss.str());
+    }
+
+    const auto recordSize = size - CHECKSUM_SIZE;
+    const bool verify = _options.verify_checksums == ChecksumVerification::ALL
+        || (_options.verify_checksums == ChecksumVerification::ACTIVE_SEGMENT && segment == _activeSegmentNumber);
+
+    if (verify)
+    {
+        std::uint32_t crc = 0;
+        std::memcpy(&crc, data + recordSize, sizeof(crc));
+        if (Crc32c(data, recordSize) != crc)
+        {
+            std::stringstream ss;
+            ss << "record at offset " << offset << " of segment " << segment << " does not match its checksum";
+            throw std::runtime_error(ss.str());
+        }
+    }
+
+    return { data, recordSize };
+}
+
+template<class ThingT>
+void AshDB<ThingT>::addIndexEntry(std::size_t value)
+{
+    const auto segmentCount = (_activeSegmentNumber - _startSegmentNumber) + 1;
+    if (_segmentIndices.size() < segmentCount)
+    {
+        assert(_segmentIndices.size() == segmentCount - 1);
+        _segmentIndices.push_back(newSegmentIndex());
+    }
+
+    if (_segmentIndices.back().empty())
+    {
+        _segmentStarts.push_back(value);
+    }
+
+    _segmentIndices.back().push_back(value);
+}
+
+template<class ThingT>
+void AshDB<ThingT>::openAppender()
+{
+    if (_appender.isOpen())
+    {
+        return;
+    }
+
+    // segments of fixed width records don't have an index file, instead
+    // their data file starts with a header
+    if (_options.fixed_record_size == 0)
+    {
+        _appender.open(activeDataFile(), activeIndexFile(), BuildIndexFileHeader(segmentFormat()));
+
+        // a reader of a compressed segment holds a copy of its blocks, which
+        // the appender takes over keeping track of while it is open
+        if (_codec != nullptr)
+        {
+            _readCache.erase(_activeSegmentNumber);
+        }
+        return;
+    }
+
+    _appender.open(activeDataFile(), {});
+    if (_appender.dataSize() == 0)
+    {
+        const auto header = BuildFixedSegmentHeader(indexEntry(dataStart()), fixedSlotSize(), segmentFormat());
+        _appender.append(header.data(), header.size(), nullptr, 0);
+    }
+}
+
+template<class ThingT>
+void AshDB<ThingT>::rolloverSegment()
+{
+    // the files of a sealed segment are never synced again once closed
+    if (_options.sync_policy != SyncPolicy::NONE)
+    {
+        _appender.sync();
+    }
+
+    _appender.flush();
+    const auto segmentSize = _appender.isOpen() ? _appender.storedSize() : activeFileSize();
+    _appender.close();
+
+    if (_segmentIndices.size() == static_cast<std::size_t>(_activeSegmentNumber - _startSegmentNumber) + 1)
+    {
+        if (_options.fixed_record_size == 0 && !_segmentIndices.back().empty())
+        {
+            sealSegment(_activeSegmentNumber, _segmentIndices.back().entries());
+        }
+
+        _segmentIndices.back().seal();
+        if (_options.lazy_index_loading)
+        {
+            trackLoadedIndex(_activeSegmentNumber);
+        }
+
+        _segmentSizes.push_back(segmentSize);
+        _sealedSize += segmentSize;
+    }
+
+    // drop the buffered reader of the segment being sealed so that it can
+    // be memory mapped, or have its footer and blocks read, the next time it
+    // is read
+    if (_options.mmap_sealed_segments || _options.fixed_record_size == 0)
+    {
+        evictSegment(_activeSegmentNumber);
+    }
+
+    _activeSegmentNumber++;
+}
+
+template<class ThingT>
+void AshDB<ThingT>::sealSegment(std::uint16_t segment, const std::vector<std::size_t>& entries)
+{
+    const auto datafile = buildDataFilename(segment);
+    const auto format = segmentFormat();
+    const auto footer = BuildSegmentFooter(entries, fs::file_size(datafile), format.compression, format.checksums);
+
+    // the index file is only removed once the footer that replaces it is
+    // written, or synced if the segment's records are synced as well
+    File file{ datafile, File::Mode::Append };
+    file.write(footer.data(), footer.size());
+    if (_options.sync_policy != SyncPolicy::NONE)
+    {
+        file.sync();
+    }
+    file.close();
+
+    fs::remove(buildIndexFilename(segment));
+}
+
+template<class ThingT>
+void AshDB<ThingT>::unsealSegment(std::uint16_t segment)
+{
+    const auto datafile = buildDataFilename(segment);
+    std::optional<SegmentFooter> footer;
+    std::vector<std::size_t> entries;
+    {
+        const File file{ datafile, File::Mode::Read };
+        footer = ashdb::ReadSegmentFooter(file);
+        if (!footer.has_value())
+        {
+            return;
+        }
+        entries = ashdb::ReadSegmentFooterEntries(file, *footer);
+    }
+
+    // the index file is written in full before the footer is removed
+    const auto indexfile = buildIndexFilename(segment);
+    fs::remove(indexfile);
+    {
+        const auto header = BuildIndexFileHeader(segmentFormat());
+        File file{ indexfile, File::Mode::Append };
+        file.write(header.data(), header.size());
+        file.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(std::size_t));
+        if (_options.sync_policy != SyncPolicy::NONE)
+        {
+            file.sync();
+        }
+    }
+
+    fs::resize_file(datafile, footer->dataSize);
+}
+
+template<class ThingT>
+std::optional<SegmentFooter> AshDB<ThingT>::segmentFooter(std::uint16_t segment) const
 {
-    std::scoped_lock lock{_readWriteMutex};
-
-    auto [currentRecord, localIndex] = findIndexDetails(index);
-    auto readOffset = localIndex == 0 ? 0 : _segmentIndices[currentRecord][localIndex];
-
-    const auto dataFile = buildDataFilename(currentRecord);
-    std::ifstream datafs;
-    datafs.exceptions(std::ifstream::badbit | std::ifstream::failbit);
-    datafs.open(dataFile.data(), std::ios_base::binary);
-
-    datafs.seekg(readOffset);
-
-    ThingT thing;
-    ashdb_read(datafs, thing);
-    datafs.close();
+    const auto datafile = buildDataFilename(segment);
+    if (!fs::exists(datafile))
+    {
+        return std::nullopt;
+    }
 
-    return thing;
+    return ashdb::ReadSegmentFooter(File{ datafile, File::Mode::Read });
 }
 
 template<class ThingT>
-auto AshDB<ThingT>::read(std::size_t index, std::size_t count) const -> AshDB<ThingT>::Batch
+std::vector<std::size_t> AshDB<ThingT>::readSealedEntries(std::uint16_t segment) const
 {
-    std::scoped_lock lock{_readWriteMutex};
-
-    AshDB<ThingT>::Batch batch;
-    const auto endIndex = index + count;
-    auto [segment, offsetIndex] = findIndexDetails(index);
-
-    for (auto i = index; i < (index + count);)
     {
-        auto localMax = _segmentIndices[segment].size();
-        if (endIndex <= (_segmentIndices[segment][0] + _segmentIndices[segment].size()))
+        const File file{ buildDataFilename(segment), File::Mode::Read };
+        if (const auto footer = ashdb::ReadSegmentFooter(file); footer.has_value())
         {
-            localMax = endIndex - _segmentIndices[segment][0];
+            return ashdb::ReadSegmentFooterEntries(file, *footer);
         }
+    }
 
-        const auto datafile = this->buildDataFilename(segment);
-        std::ifstream datafs;
-        datafs.exceptions(std::ifstream::badbit | std::ifstream::failbit);
-        datafs.open(datafile.data(), std::ios_base::binary);
+    return ashdb::ReadIndexFile(buildIndexFilename(segment));
+}
 
-        for (; offsetIndex < localMax; ++i, ++offsetIndex)
-        {
-            auto readOffset = offsetIndex == 0 ? 0 : _segmentIndices[segment][offsetIndex];
-            datafs.seekg(readOffset);
+template<class ThingT>
+std::uintmax_t AshDB<ThingT>::databaseSize() const
+{
+    // the active segment is counted by the appender while it is open, which
+    // includes the records it hasn't written yet
+    return _sealedSize + (_appender.isOpen() ? _appender.storedSize() : activeFileSize());
+}
 
-            ThingT thing;
-            ashdb_read(datafs, thing);
-            batch.push_back(std::move(thing));
-        }
+template<class ThingT>
+std::uint64_t AshDB<ThingT>::activeFileSize() const
+{
+    std::error_code error;
+    const auto size = fs::file_size(activeDataFile(), error);
+    return error ? 0 : static_cast<std::uint64_t>(size);
+}
 
-        datafs.close();
-        offsetIndex = 0;
-        segment++;
+template<class ThingT>
+std::size_t AshDB<ThingT>::size() const
+{
+    std::shared_lock lock{ _readWriteMutex };
+    if (!_open || !_startIndex.has_value())
+    {
+        assert(!_lastIndex.has_value());
+        return 0;
     }
 
-    return batch;
+    return (*_lastIndex - *_startIndex) + 1;
 }
 
 template<class ThingT>
-void AshDB<ThingT>::truncate(std::size_t startIndex)
+typename AshDB<ThingT>::IndexDetails AshDB<ThingT>::findIndexDetails(std::size_t index) const
 {
-    std::scoped_lock lock{_readWriteMutex};
-
-    auto [currentSegment, localIndex] = findIndexDetails(startIndex);
-
-    if (localIndex > 0)
+    if (index < _startIndex || index > _lastIndex)
     {
-        // trim the data file
-        const auto offset = _segmentIndices[currentSegment][localIndex];
-        const auto datafile { buildDataFilename(currentSegment) };
-        fs::resize_file(datafile.c_str(), offset);
+        std::stringstream ss;
+        ss << "index " << index << " is out of bounds";
+        throw std::runtime_error(ss.str());
+    }
 
-        // trim the index file
-        const auto indexfile { buildIndexFilename(currentSegment) };
-        fs::resize_file(indexfile.c_str(), localIndex * sizeof(std::size_t));
+    const auto& starts = _segmentStarts;
+    assert(!starts.empty() && starts.size() == _segmentIndices.size());
 
-        // start deleting segment files at the next segment
-        currentSegment++;
+    // segments usually hold the same number of records, in which case the
+    // position can be calculated directly from the size of the first segment
+    std::size_t position = starts.size();
+    if (starts.size() > 1)
+    {
+        const auto perSegment = starts[1] - starts[0];
+        const auto guess = std::min((index - starts[0]) / perSegment, starts.size() - 1);
+        if (starts[guess] <= index
+            && (guess + 1 == starts.size() || index < starts[guess + 1]))
+        {
+            position = guess;
+        }
     }
 
-    // delete all excess segment and index files
-    while (currentSegment <= _activeSegmentNumber)
+    if (position == starts.size())
     {
-        const auto datafile { buildDataFilename(currentSegment) };
-        fs::remove(datafile.c_str());
-
-        const auto indexfile { buildIndexFilename(currentSegment) };
-        bfs:remove(indexfile.c_str());
+        const auto it = std::upper_bound(starts.begin(), starts.end(), index);
+        position = static_cast<std::size_t>(std::distance(starts.begin(), it)) - 1;
+    }
 
-        currentSegment++;
+    const auto localIndex = index - starts[position];
+    if (localIndex >= _segmentIndices[position].size())
+    {
+        std::stringstream ss;
+        ss << "index " << index << " could not be found";
+        throw std::runtime_error(ss.str());
     }
 
-    reset();
+    return IndexDetails{ _startSegmentNumber + position, localIndex };
 }
 
 template<class ThingT>
-void AshDB<ThingT>::reset()
+auto AshDB<ThingT>::segmentReader(std::uint16_t segment) const -> SegmentReader
 {
-    findFileBoundaries();
-
-    // load the record-index
-    _segmentIndices.clear();
-    for (auto i = _startSegmentNumber; i <= _activeSegmentNumber; ++i)
+    std::scoped_lock lock{_cacheMutex};
+    return _readCache.get(segment, [this, segment]()
     {
-        const auto indexFilename = buildIndexFilename(i);
-        if (fs::exists(indexFilename))
+        SegmentReader reader;
+        const auto datafile = buildDataFilename(segment);
+
+        // the data of a sealed segment can only change through retention or
+        // truncation, both of which evict the segment from the cache first
+        if (_options.mmap_sealed_segments && _codec == nullptr && segment < _activeSegmentNumber)
         {
-            _segmentIndices.push_back({});
-            _segmentIndices.back() = ashdb::ReadIndexFile(indexFilename);
+            reader.mapping = std::make_shared<const MappedFile>(datafile);
+        }
+        else
+        {
+            reader.file = std::make_shared<const File>(datafile, File::Mode::Read);
         }
-    }
 
-    findIndexBoundaries();
+        // the records of a sealed segment are followed by its footer
+        if (_options.fixed_record_size == 0 && segment < _activeSegmentNumber)
+        {
+            const auto footer = reader.mapping
+                ? ParseSegmentFooter(reader.mapping->data() + reader.mapping->size()
+                                         - std::min(reader.mapping->size(), SEGMENT_FOOTER_SIZE),
+                                     reader.mapping->size())
+                : ReadSegmentFooter(*reader.file);
+            if (footer.has_value())
+            {
+                reader.dataSize = footer->dataSize;
+            }
+        }
+
+        if (_codec != nullptr && (segment != _activeSegmentNumber || !_appender.isOpen()))
+        {
+            reader.blocks = std::make_shared<const BlockTable>(reader.dataSize
+                ? ReadBlockTable(*reader.file, *reader.dataSize)
+                : ReadBlockTable(*reader.file));
+        }
+
+        return reader;
+    });
 }
 
 template<class ThingT>
-void AshDB<ThingT>::findFileBoundaries()
+std::pair<std::uint64_t, std::uint64_t> AshDB<ThingT>::recordSpan(const SegmentReader& reader,
+                                                                  std::size_t position,
+                                                                  std::size_t localIndex) const
 {
-    fs::path dbpath{_dbfolder};
+    // lazily loaded indices can be loaded or unloaded by any reader, so the
+    // offsets are only read while holding the cache lock
+    std::unique_lock<std::mutex> lock{ _cacheMutex, std::defer_lock };
+    if (_options.lazy_index_loading)
+    {
+        lock.lock();
+    }
 
-    // early fail if the folder is empty
-    if (fs::is_empty(dbpath))
+    const auto& offsets = segmentIndex(position);
+    const auto begin = offsets.offset(localIndex);
+    if (_options.fixed_record_size > 0)
     {
-        return;
+        return { begin, begin + fixedSlotSize() };
+    }
+    else if (localIndex + 1 < offsets.size())
+    {
+        return { begin, offsets.offset(localIndex + 1) };
+    }
+
+    // the last record of a segment runs to the end of its records, which is
+    // the end of the data file unless it has a footer. The size of the active
+    // data file is already known if it is open for writing
+    if (reader.blocks)
+    {
+        return { begin, reader.blocks->rawSize() };
+    }
+    else if (reader.dataSize)
+    {
+        return { begin, *reader.dataSize };
+    }
+    else if (reader.mapping)
+    {
+        return { begin, reader.mapping->size() };
+    }
+    else if (_startSegmentNumber + position == _activeSegmentNumber && _appender.isOpen())
+    {
+        return { begin, _appender.dataSize() };
     }
 
-    // there is no portable glob method, so for now we're going to use this
-    // brute force and ugly method to get the boundaries
-    bool found = false;
-    std::uint16_t start = 0;
-    std::uint16_t end = 0;
+    return { begin, reader.file->size() };
+}
+
+template<class ThingT>
+void AshDB<ThingT>::copySegmentBytes(std::size_t segment, const SegmentReader& reader,
+                                     std::uint64_t offset, char* out, std::size_t size) const
+{
+    const auto fail = [segment, offset, size]()
+    {
+        std::stringstream ss;
+        ss << "could not read " << size << " bytes at offset " << offset << " of segment " << segment;
+        throw std::runtime_error(ss.str());
+    };
+
+    // the bytes past the written part of the active data file are still
+    // buffered in the appender
+    const auto& pending = _appender.pendingData();
+    const auto written = (segment == _activeSegmentNumber && !pending.empty())
+        ? _appender.writtenDataSize()
+        : std::numeric_limits<std::uint64_t>::max();
 
-    for (std::uint16_t i = 0u; i < std::numeric_limits<std::uint16_t>::max(); ++i)
+    std::size_t copied = 0;
+    if (offset < written)
     {
-        auto filename = buildDataFilename(i);
-        if (fs::exists(filename))
+        copied = static_cast<std::size_t>(std::min<std::uint64_t>(size, written - offset));
+        if (_codec != nullptr)
+        {
+            copyBlockBytes(segment, reader, offset, out, copied);
+        }
+        else if (reader.mapping)
         {
-            if (!found)
+            if (offset + copied > reader.mapping->size())
             {
-                start = i;
-                found = true;
+                fail();
             }
+            std::memcpy(out, reader.mapping->data() + offset, copied);
         }
-        else if (found)
+        else if (reader.file->read(out, copied, offset) != copied)
         {
-            assert(i > 0);
-            end = i - 1;
-            break;
+            fail();
         }
     }
 
-    _startSegmentNumber = start;
-    _activeSegmentNumber = std::max(_startSegmentNumber, end);
-
-    if (const auto datafile = activeDataFile();
-        _options.filesize_max != 0
-        && fs::exists(datafile.data())
-        && fs::file_size(datafile.data()) >= _options.filesize_max)
+    if (copied < size)
     {
-        _activeSegmentNumber++;
+        const auto pendingOffset = static_cast<std::size_t>(offset + copied - written);
+        if (pendingOffset + (size - copied) > pending.size())
+        {
+            fail();
+        }
+        std::memcpy(out + copied, pending.data() + pendingOffset, size - copied);
     }
 }
 
 template<class ThingT>
-void AshDB<ThingT>::findIndexBoundaries()
+void AshDB<ThingT>::copyBlockBytes(std::size_t segment, const SegmentReader& reader,
+                                   std::uint64_t offset, char* out, std::size_t size) const
 {
-    _startIndex.reset();
-    _lastIndex.reset();
+    const auto& blocks = (segment == _activeSegmentNumber && _appender.isOpen())
+        ? _appender.blocks()
+        : *reader.blocks;
 
-    // load the accessor boundaries
-    if (_segmentIndices.size() > 0)
+    if (offset + size > blocks.rawSize())
     {
-        assert(_segmentIndices.front().size() > 0);
-        _startIndex = _segmentIndices.front().at(0);
+        std::stringstream ss;
+        ss << "could not read " << size << " bytes at offset " << offset << " of segment " << segment;
+        throw std::runtime_error(ss.str());
+    }
 
-        assert(_segmentIndices.back().size() > 0);
-        _lastIndex = _segmentIndices.back().front() + (_segmentIndices.back().size() - 1);
+    for (std::size_t copied = 0; copied < size;)
+    {
+        const auto position = offset + copied;
+        const auto block = blocks.find(position);
+        const auto& data = blockData(segment, reader, blocks, block);
+
+        const auto start = static_cast<std::size_t>(position - blocks.rawStart(block));
+        const auto count = std::min(size - copied, data.size() - start);
+        std::memcpy(out + copied, data.data() + start, count);
+        copied += count;
     }
 }
 
 template<class ThingT>
-void AshDB<ThingT>::updateIndexing()
+const std::vector<char>& AshDB<ThingT>::blockData(std::size_t segment, const SegmentReader& reader,
+                                                  const BlockTable& blocks, std::size_t block) const
 {
-    if (!_startIndex.has_value())
+    struct CachedBlock
     {
-        assert(!_lastIndex.has_value());
-        _startIndex = 0;
-        _lastIndex = 0;
-    }
-    else
+        std::uint64_t       generation = 0;
+        std::size_t         segment = 0;
+        std::uint64_t       fileStart = 0;
+        std::vector<char>   data;
+    };
+    thread_local CachedBlock cached;
+    thread_local std::vector<char> stored;
+
+    if (_blockGeneration != 0
+        && cached.generation == _blockGeneration
+        && cached.segment == segment
+        && cached.fileStart == blocks.fileStart(block))
     {
-        (*_lastIndex)++;
+        return cached.data;
     }
 
-    // now see if the database is too big and we need to trim it down
-    if (_options.database_max > 0
-        && databaseSize() > _options.database_max)
+    // the cached block is only valid again once it has been decompressed
+    cached.generation = 0;
+
+    const auto start = blocks.fileStart(block) + BLOCK_HEADER_SIZE;
+    stored.resize(static_cast<std::size_t>(blocks.fileEnd(block) - start));
+    if (reader.file->read(stored.data(), stored.size(), start) != stored.size())
     {
-        const auto fn = buildDataFilename(_startSegmentNumber);
-        const auto ifn = buildIndexFilename(_startSegmentNumber);
-        fs::remove(fn);
-        fs::remove(ifn);
+        std::stringstream ss;
+        ss << "could not read the block at offset " << blocks.fileStart(block) << " of segment " << segment;
+        throw std::runtime_error(ss.str());
+    }
 
-        _startSegmentNumber++;
-        _segmentIndices.erase(_segmentIndices.begin());
-        _startIndex = _segmentIndices.front().at(0);
+    cached.data.resize(static_cast<std::size_t>(blocks.rawEnd(block) - blocks.rawStart(block)));
+    DecodeBlock(*_codec, stored.data(), stored.size(), cached.data.data(), cached.data.size());
+
+    cached.generation = _blockGeneration;
+    cached.segment = segment;
+    cached.fileStart = blocks.fileStart(block);
+    return cached.data;
+}
+
+template<class ThingT>
+const char* AshDB<ThingT>::segmentBytes(std::size_t segment, const SegmentReader& reader,
+                                        std::uint64_t offset, std::size_t size,
+                                        std::vector<char>& buffer) const
+{
+    const auto& pending = _appender.pendingData();
+    if (segment == _activeSegmentNumber
+        && !pending.empty()
+        && offset >= _appender.writtenDataSize()
+        && (offset - _appender.writtenDataSize()) + size <= pending.size())
+    {
+        return pending.data() + (offset - _appender.writtenDataSize());
+    }
+    else if (reader.mapping && offset + size <= reader.mapping->size())
+    {
+        return reader.mapping->data() + offset;
     }
+
+    buffer.resize(size);
+    copySegmentBytes(segment, reader, offset, buffer.data(), size);
+    return buffer.data();
 }
 
 template<class ThingT>
-void AshDB<ThingT>::writeIndexEntry(std::size_t offset)
+ThingT AshDB<ThingT>::readRecord(std::size_t segment, const SegmentReader& reader,
+                                 std::uint64_t begin, std::uint64_t end) const
 {
-    auto value = offset;
+    if (end < begin)
+    {
+        std::stringstream ss;
+        ss << "record at offset " << begin << " has an invalid size";
+        throw std::runtime_error(ss.str());
+    }
 
-    if (value == 0)
+    ThingT thing;
+    if constexpr (IsRawRecord<ThingT>)
     {
-        if (_segmentIndices.size() > 0)
+        if (_options.checksums)
         {
-            value = _segmentIndices.back().at(0) + _segmentIndices.back().size();
+            thread_local std::vector<char> buffer;
+            const auto size = static_cast<std::size_t>(end - begin);
+            return decode(recordBytes(segment, begin, segmentBytes(segment, reader, begin, size, buffer), size));
         }
-    }
 
-    std::string indexfile = activeIndexFile();
-    std::ofstream indexfs;
-    indexfs.exceptions(std::ofstream::badbit | std::ofstream::failbit);
-    indexfs.open(indexfile.c_str(), std::ios::out | std::ios::binary | std::ios::app);
-    ashdb::ashdb_write(indexfs, value);
-    indexfs.close();
+        // the last record of a segment runs to the end of the file, which
+        // may be longer than the record itself
+        if (end - begin < sizeof(ThingT))
+        {
+            std::stringstream ss;
+            ss << "record at offset " << begin << " is smaller than a raw record";
+            throw std::runtime_error(ss.str());
+        }
 
-    const auto segmentCount = (_activeSegmentNumber - _startSegmentNumber) + 1;
-    if (_segmentIndices.size() < segmentCount)
+        copySegmentBytes(segment, reader, begin, reinterpret_cast<char*>(&thing), sizeof(ThingT));
+    }
+    else
     {
-        assert(_segmentIndices.size() == segmentCount - 1);
-        _segmentIndices.push_back({});
+        // each thread reuses its own buffer so that reads neither allocate
+        // nor share any state with each other
+        thread_local std::vector<char> buffer;
+        const auto size = static_cast<std::size_t>(end - begin);
+        const auto bytes = recordBytes(segment, begin, segmentBytes(segment, reader, begin, size, buffer), size);
+        decodeRecord(bytes.data(), bytes.size(), thing);
     }
 
-    _segmentIndices.back().push_back(value);
+    return thing;
 }
 
 template<class ThingT>
-std::uintmax_t AshDB<ThingT>::databaseSize() const
+void AshDB<ThingT>::decodeRecord(const char* data, std::size_t size, ThingT& thing)
 {
-    std::uintmax_t retval = 0;
-    for (auto i = _startSegmentNumber; i <= _activeSegmentNumber; ++i)
+    if constexpr (IsBufferSerializable<ThingT>)
+    {
+        BufferReader bytes{ data, size };
+        ashdb_read(bytes, thing);
+    }
+    else
     {
-        const auto filename = buildDataFilename(i);
+        MemoryStream stream{ data, size };
+        stream.exceptions(std::ios_base::badbit | std::ios_base::failbit);
+        ashdb_read(stream, thing);
+    }
+}
 
-        if (!fs::exists(filename))
-        {
-            assert(i == _activeSegmentNumber);
-            break;
-        }
+template<class ThingT>
+void AshDB<ThingT>::evictSegment(std::uint16_t segment)
+{
+    _readCache.erase(segment);
 
-        retval += static_cast<std::uint64_t>(fs::file_size(filename));
+    if (const auto bytes = _loadedIndexes.find(segment); bytes != nullptr)
+    {
+        _loadedIndexMemory -= *bytes;
+        _loadedIndexes.erase(segment);
     }
-    
-    return retval;
 }
 
 template<class ThingT>
-std::size_t AshDB<ThingT>::size() const
+void AshDB<ThingT>::trimDatabase()
 {
-    if (!_open || !_startIndex.has_value())
+    if (_options.database_max == 0)
     {
-        assert(!_lastIndex.has_value());
-        return 0;
+        return;
     }
 
-    return (*_lastIndex - *_startIndex) + 1;
+    while (_segmentIndices.size() > 1
+        && !_segmentSizes.empty()
+        && databaseSize() > _options.database_max)
+    {
+        expireSegment();
+    }
 }
 
-// TODO: this could be improved
 template<class ThingT>
-typename AshDB<ThingT>::IndexDetails AshDB<ThingT>::findIndexDetails(std::size_t index) const
+void AshDB<ThingT>::expireSegment()
 {
-    if (index < _startIndex || index > _lastIndex)
+    reapSegment(_startSegmentNumber);
+
+    _sealedSize -= _segmentSizes.front();
+    _segmentSizes.erase(_segmentSizes.begin());
+    _startSegmentNumber++;
+    _segmentIndices.erase(_segmentIndices.begin());
+    _segmentStarts.erase(_segmentStarts.begin());
+    _startIndex = _segmentIndices.front().at(0);
+}
+
+template<class ThingT>
+void AshDB<ThingT>::reapSegment(std::uint16_t segment)
+{
+    // the reaper also closes the read handle, which unmaps a mapped segment
+    ExpiredSegment expired;
+    if (const auto reader = _readCache.find(segment); reader != nullptr)
     {
-        std::stringstream ss;
-        ss << "index " << index << " is out of bounds";
-        throw std::runtime_error(ss.str());
+        expired.reader = *reader;
     }
+    evictSegment(segment);
+    expired.datafile = buildDataFilename(segment);
+    expired.indexfile = buildIndexFilename(segment);
 
-    std::optional<std::size_t> localIndex = 0;
-    std::size_t currentSegment = _startSegmentNumber;
-    for (const auto& offsets : _segmentIndices)
     {
-        if (index < (offsets.front() + offsets.size()))
+        std::scoped_lock reaperLock{ _reaperMutex };
+        _expiredSegments.push_back(std::move(expired));
+        if (!_reaper.joinable())
         {
-            localIndex = index - offsets.front();
-            break;
+            _reaper = std::thread{ &AshDB<ThingT>::runReaper, this };
         }
-        else
+    }
+    _reaperCondition.notify_all();
+}
+
+template<class ThingT>
+void AshDB<ThingT>::runReaper()
+{
+    std::unique_lock reaperLock{ _reaperMutex };
+    while (true)
+    {
+        _reaperCondition.wait(reaperLock, [this]() { return _reaperStop || !_expiredSegments.empty(); });
+        if (_expiredSegments.empty())
         {
-            currentSegment++;
+            return;
         }
+
+        auto expired = std::move(_expiredSegments.front());
+        _expiredSegments.pop_front();
+        _reaperBusy = true;
+        reaperLock.unlock();
+
+        // nothing can be reported from this thread, a file that can't be
+        // deleted is left for the user to clean up
+        expired.reader = {};
+        std::error_code error;
+        fs::remove(expired.datafile, error);
+        fs::remove(expired.indexfile, error);
+
+        reaperLock.lock();
+        _reaperBusy = false;
+        _reaperCondition.notify_all();
     }
+}
+
+template<class ThingT>
+void AshDB<ThingT>::waitForReaper()
+{
+    std::unique_lock reaperLock{ _reaperMutex };
+    _reaperCondition.wait(reaperLock, [this]() { return _expiredSegments.empty() && !_reaperBusy; });
+}
 
-    if (!localIndex.has_value())
+template<class ThingT>
+void AshDB<ThingT>::stopReaper()
+{
     {
-        std::stringstream ss;
-        ss << "index " << index << " could not be found";
-        throw std::runtime_error(ss.str());
+        std::scoped_lock reaperLock{ _reaperMutex };
+        if (!_reaper.joinable())
+        {
+            return;
+        }
+        _reaperStop = true;
+    }
+
+    _reaperCondition.notify_all();
+    _reaper.join();
+
+    std::scoped_lock reaperLock{ _reaperMutex };
+    _reaperStop = false;
+}
+
+template<class ThingT>
+const SegmentIndex& AshDB<ThingT>::segmentIndex(std::size_t position) const
+{
+    auto& index = _segmentIndices[position];
+    if (!_options.lazy_index_loading)
+    {
+        return index;
+    }
+
+    const auto segment = static_cast<std::uint16_t>(_startSegmentNumber + position);
+    if (!index.loaded())
+    {
+        index.load(readSealedEntries(segment));
+    }
+
+    // the active segment is always loaded and is never unloaded
+    if (segment < _activeSegmentNumber)
+    {
+        trackLoadedIndex(segment);
+    }
+
+    return index;
+}
+
+template<class ThingT>
+void AshDB<ThingT>::trackLoadedIndex(std::uint16_t segment) const
+{
+    _loadedIndexes.get(segment, [this, segment]()
+    {
+        const auto bytes = _segmentIndices[segment - _startSegmentNumber].memoryUsage();
+        _loadedIndexMemory += bytes;
+        return bytes;
+    });
+
+    // never unload the segment that was just used since the caller
+    // is about to read its offsets
+    while (_options.index_memory_budget > 0
+        && _loadedIndexMemory > _options.index_memory_budget
+        && _loadedIndexes.size() > 1)
+    {
+        const auto [lru, bytes] = _loadedIndexes.popLeastRecent();
+        _segmentIndices[lru - _startSegmentNumber].unload();
+        _loadedIndexMemory -= bytes;
     }
+}
 
-    return IndexDetails{currentSegment, *localIndex };
+template<class ThingT>
+std::size_t AshDB<ThingT>::indexMemoryUsage() const
+{
+    std::size_t retval = 0;
+    for (const auto& index : _segmentIndices)
+    {
+        retval += index.memoryUsage();
+    }
+    return retval;
 }
 
 template<class ThingT>
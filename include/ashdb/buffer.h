@@ -0,0 +1,108 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+namespace ashdb
+{
+
+// A growing arena that records are serialized into without any of the
+// virtual calls and sentries of `std::ostream`. Types that provide an
+// `ashdb_write(BufferWriter&, const T&)` overload are serialized with it
+// instead of their `std::ostream` overload
+class BufferWriter final
+{
+public:
+    BufferWriter() = default;
+    BufferWriter(const BufferWriter&) = delete;
+
+    void write(const char* data, std::size_t size)
+    {
+        const auto offset = _buffer.size();
+        _buffer.resize(offset + size);
+        std::memcpy(_buffer.data() + offset, data, size);
+    }
+
+    const char* data() const noexcept { return _buffer.data(); }
+    std::size_t size() const noexcept { return _buffer.size(); }
+
+    // empties the buffer but keeps the allocated memory for the next record
+    void clear() noexcept { _buffer.clear(); }
+
+    // drops everything past the first `size` bytes, i.e. a record that
+    // turned out to be invalid after it was serialized
+    void truncate(std::size_t size)
+    {
+        if (size < _buffer.size())
+        {
+            _buffer.resize(size);
+        }
+    }
+
+private:
+    std::string _buffer;
+};
+
+// Reads the bytes of a single record, i.e. in place from a memory mapped
+// segment, the counterpart of `BufferWriter` for `ashdb_read` overloads.
+// Throws std::runtime_error if a read runs past the end of the record
+class BufferReader final
+{
+public:
+    BufferReader(const char* data, std::size_t size) noexcept
+        : _position{ data },
+          _end{ data + size }
+    {
+    }
+
+    BufferReader(const BufferReader&) = delete;
+
+    void read(char* out, std::size_t size)
+    {
+        if (size > remaining())
+        {
+            throw std::runtime_error("read of " + std::to_string(size)
+                + " bytes is past the end of the record");
+        }
+
+        std::memcpy(out, _position, size);
+        _position += size;
+    }
+
+    std::size_t remaining() const noexcept
+    {
+        return static_cast<std::size_t>(_end - _position);
+    }
+
+private:
+    const char* _position;
+    const char* _end;
+};
+
+// true for the types that have both an `ashdb_write` overload for
+// `BufferWriter` and an `ashdb_read` overload for `BufferReader`. User types
+// opt in by providing both, either directly or with overloads templated on
+// the stream type, i.e.
+//
+//     template<typename StreamT>
+//     void ashdb_write(StreamT& stream, const Point& p) { ... }
+template<typename T, typename = void>
+struct BufferSerializable : std::false_type
+{
+};
+
+template<typename T>
+struct BufferSerializable<T, std::void_t<
+        decltype(ashdb_write(std::declval<BufferWriter&>(), std::declval<const T&>())),
+        decltype(ashdb_read(std::declval<BufferReader&>(), std::declval<T&>()))>>
+    : std::true_type
+{
+};
+
+template<typename T>
+constexpr bool IsBufferSerializable = BufferSerializable<T>::value;
+
+} // namespace ashdb
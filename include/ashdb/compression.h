@@ -0,0 +1,119 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "file.h"
+#include "options.h"
+
+namespace ashdb
+{
+
+// Compresses and decompresses the blocks of a compressed segment. A codec
+// holds no state, so a single instance is shared by every reader and writer
+class BlockCodec
+{
+public:
+    virtual ~BlockCodec() = default;
+
+    // appends the compressed form of the `size` bytes at `data` to `out`
+    virtual void compress(const char* data, std::size_t size, std::string& out) const = 0;
+
+    // decompresses the `size` bytes at `data` into the `rawSize` bytes at
+    // `out`, throws std::runtime_error if the data is corrupt or does not
+    // decompress to exactly `rawSize` bytes
+    virtual void decompress(const char* data, std::size_t size,
+                            char* out, std::size_t rawSize) const = 0;
+};
+
+// An LZ77 codec in the style of LZ4. Each sequence is a token holding the
+// lengths of a run of literals and of the match that follows it, the
+// literals themselves and a 16-bit offset back to the start of the match.
+// Matches are found through a single hash table of the last position of
+// every 4 byte prefix, so compression is fast but not particularly thorough
+class LZCodec final : public BlockCodec
+{
+public:
+    void compress(const char* data, std::size_t size, std::string& out) const override;
+    void decompress(const char* data, std::size_t size,
+                    char* out, std::size_t rawSize) const override;
+};
+
+// returns the codec for `compression`, or nullptr for `Compression::NONE`
+const BlockCodec* GetBlockCodec(Compression compression);
+
+// every block of a compressed data file starts with a header that holds the
+// size of the block as stored and its uncompressed size, both as 32-bit
+// values. A block whose data did not get any smaller is stored uncompressed,
+// in which case both sizes are the same
+constexpr std::size_t BLOCK_HEADER_SIZE = 8;
+
+// appends the header and the (possibly) compressed data of a block holding
+// the `size` bytes at `data` to `out`
+void AppendBlock(const BlockCodec& codec, const char* data, std::size_t size, std::string& out);
+
+// decodes the `storedSize` bytes of a block's data, without its header,
+// into the `rawSize` bytes at `out`
+void DecodeBlock(const BlockCodec& codec, const char* data, std::size_t storedSize,
+                 char* out, std::size_t rawSize);
+
+// The blocks of a compressed data file, which map the offsets of the
+// uncompressed records (the offsets in the segment's index) to the blocks
+// that hold them
+class BlockTable final
+{
+public:
+    // adds the block that follows the last one
+    void push_back(std::uint32_t storedSize, std::uint32_t rawSize);
+
+    std::size_t size() const noexcept { return _rawStarts.size(); }
+    bool empty() const noexcept { return _rawStarts.empty(); }
+
+    // returns the block that holds the uncompressed byte at `offset`, which
+    // must be less than `rawSize()`
+    std::size_t find(std::uint64_t offset) const;
+
+    // the range of uncompressed bytes held by a block
+    std::uint64_t rawStart(std::size_t block) const { return _rawStarts[block]; }
+    std::uint64_t rawEnd(std::size_t block) const
+    {
+        return block + 1 < size() ? _rawStarts[block + 1] : _rawSize;
+    }
+
+    // the range of a block in the data file, including its header
+    std::uint64_t fileStart(std::size_t block) const { return _fileStarts[block]; }
+    std::uint64_t fileEnd(std::size_t block) const
+    {
+        return block + 1 < size() ? _fileStarts[block + 1] : _fileSize;
+    }
+
+    // the size of all the blocks uncompressed and as stored
+    std::uint64_t rawSize() const noexcept { return _rawSize; }
+    std::uint64_t fileSize() const noexcept { return _fileSize; }
+
+private:
+    std::vector<std::uint64_t>  _rawStarts;
+    std::vector<std::uint64_t>  _fileStarts;
+    std::uint64_t               _rawSize = 0;
+    std::uint64_t               _fileSize = 0;
+};
+
+// returns the blocks of a compressed data file by walking their headers,
+// stopping at the first block that is incomplete
+BlockTable ReadBlockTable(const File& file);
+
+// the same for the blocks in the first `size` bytes of the file, i.e. the
+// records of a sealed segment, which are followed by its footer
+BlockTable ReadBlockTable(const File& file, std::uint64_t size);
+
+// cuts a compressed data file down to its first `rawSize` uncompressed
+// bytes. The block that holds the new end is replaced by a block of the
+// part of it that is kept
+void TruncateBlocks(const std::string& filename, std::uint64_t rawSize, const BlockCodec& codec);
+
+// returns a number that has never been returned before, which identifies
+// the contents of a database's segments in caches shared by every database.
+// It is never 0
+std::uint64_t NextBlockGeneration();
+
+} // namespace ashdb
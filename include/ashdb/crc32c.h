@@ -0,0 +1,20 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+
+namespace ashdb
+{
+
+// returns the CRC32C (Castagnoli) checksum of `size` bytes at `data`, which
+// continues `crc` when checksumming data in several pieces. Uses the SSE4.2
+// crc32 instruction if the CPU has it, and a table driven implementation
+// otherwise
+std::uint32_t Crc32c(const char* data, std::size_t size, std::uint32_t crc = 0);
+
+// the same as `Crc32c` without ever using the SSE4.2 instruction
+std::uint32_t Crc32cPortable(const char* data, std::size_t size, std::uint32_t crc = 0);
+
+// true if `Crc32c` uses the SSE4.2 instruction on this CPU
+bool Crc32cAccelerated();
+
+} // namespace ashdb
@@ -0,0 +1,50 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+
+namespace ashdb
+{
+
+// A succinct encoding of a non-decreasing sequence of integers. Each value is
+// split into `lowBits` stored verbatim in a packed array and the remaining
+// high bits stored in unary in a bitvector, for a total of roughly
+// 2 + log2(universe / count) bits per value. Random access is done with a
+// sampled `select` on the high bits
+class EliasFano final
+{
+public:
+    EliasFano() = default;
+
+    // `values` must be sorted in non-decreasing order
+    explicit EliasFano(const std::vector<std::uint64_t>& values);
+
+    template<class InputIt>
+    EliasFano(InputIt first, InputIt last)
+        : EliasFano(std::vector<std::uint64_t>(first, last))
+    {
+    }
+
+    // returns the i-th value of the sequence
+    std::uint64_t at(std::size_t i) const;
+
+    std::size_t size() const noexcept { return _size; }
+    bool empty() const noexcept { return _size == 0; }
+
+    // the number of bytes used by the encoded sequence
+    std::size_t memoryUsage() const noexcept;
+
+private:
+    // returns the position of the i-th set bit in `_high`
+    std::size_t select(std::size_t i) const;
+
+    std::size_t                 _size = 0;
+    std::uint32_t               _lowBits = 0;
+
+    std::vector<std::uint64_t>  _low;
+    std::vector<std::uint64_t>  _high;
+
+    // the position in `_high` of every `SampleRate`-th set bit
+    std::vector<std::uint64_t>  _samples;
+};
+
+} // namespace ashdb
@@ -0,0 +1,64 @@
+#pragma once
+#include <string>
+#include <cstdint>
+
+namespace ashdb
+{
+
+// A thin wrapper around a native file handle. Unlike the standard streams
+// there is no user-space buffering, so the size on disk is always the size
+// of the data written so far, and the handle can be kept open across calls
+class File final
+{
+public:
+    enum class Mode
+    {
+        Read,
+        Append
+    };
+
+    File() = default;
+
+    // opens (and in `Append` mode creates) the file, throws std::runtime_error
+    // if the file cannot be opened
+    File(const std::string& filename, Mode mode);
+
+    File(File&& other) noexcept;
+    File& operator=(File&& other) noexcept;
+
+    File(const File&) = delete;
+    File& operator=(const File&) = delete;
+
+    ~File();
+
+    bool isOpen() const noexcept;
+    void close() noexcept;
+
+    // appends `size` bytes to the end of the file, throws std::runtime_error
+    // if all of the bytes could not be written
+    void write(const char* data, std::size_t size);
+
+    // reads up to `size` bytes starting at `offset` without moving any shared
+    // file position, returns the number of bytes actually read
+    std::size_t read(char* data, std::size_t size, std::uint64_t offset) const;
+
+    // flushes the data written so far to the storage device, throws
+    // std::runtime_error if the data could not be flushed
+    void sync();
+
+    // returns the current size of the file on disk
+    std::uint64_t size() const;
+
+    const std::string& filename() const noexcept { return _filename; }
+
+private:
+    std::string     _filename;
+
+#ifdef _WIN32
+    void*           _handle = nullptr;
+#else
+    int             _fd = -1;
+#endif
+};
+
+} // namespace ashdb
@@ -0,0 +1,35 @@
+#pragma once
+#include <string>
+#include <cstdint>
+
+namespace ashdb
+{
+
+// A read-only memory mapping of an entire file. The file is mapped when the
+// object is constructed and unmapped when it is destroyed, so callers that
+// need the mapping to outlive a cache entry should hold it by shared_ptr
+class MappedFile final
+{
+public:
+    // maps the file, throws std::runtime_error if the file cannot be
+    // opened or mapped
+    explicit MappedFile(const std::string& filename);
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    ~MappedFile();
+
+    const char* data() const noexcept { return _data; }
+    std::size_t size() const noexcept { return _size; }
+
+private:
+    const char*     _data = nullptr;
+    std::size_t     _size = 0;
+
+#ifdef _WIN32
+    void*           _mapping = nullptr;
+#endif
+};
+
+} // namespace ashdb
@@ -0,0 +1,75 @@
+#pragma once
+#include <algorithm>
+#include <istream>
+#include <streambuf>
+#include <cstring>
+
+namespace ashdb
+{
+
+// A read-only stream over a contiguous block of memory (i.e. a memory mapped
+// segment) so that the existing `ashdb_read` overloads can decode records
+// without copying them out of the mapping first
+class MemoryStream final : public std::istream
+{
+public:
+    MemoryStream(const char* data, std::size_t size)
+        : std::istream(nullptr),
+          _streambuf{ data, size }
+    {
+        rdbuf(&_streambuf);
+    }
+
+    MemoryStream(const MemoryStream&) = delete;
+
+private:
+    struct StreamBuf : public std::streambuf
+    {
+        StreamBuf(const char* data, std::size_t size)
+        {
+            auto begin = const_cast<char*>(data);
+            setg(begin, begin, begin + size);
+        }
+
+        std::streamsize xsgetn(char_type* s, std::streamsize count) override
+        {
+            const auto available = static_cast<std::streamsize>(egptr() - gptr());
+            const auto n = std::min(count, available);
+            std::memcpy(s, gptr(), static_cast<std::size_t>(n));
+            setg(eback(), gptr() + n, egptr());
+            return n;
+        }
+
+        pos_type seekoff(off_type off, std::ios_base::seekdir dir,
+                         std::ios_base::openmode which) override
+        {
+            off_type base = 0;
+            if (dir == std::ios_base::cur)
+            {
+                base = gptr() - eback();
+            }
+            else if (dir == std::ios_base::end)
+            {
+                base = egptr() - eback();
+            }
+
+            return seekpos(pos_type(base + off), which);
+        }
+
+        pos_type seekpos(pos_type pos, std::ios_base::openmode which) override
+        {
+            const auto offset = static_cast<off_type>(pos);
+            if (!(which & std::ios_base::in) || offset < 0 || offset > (egptr() - eback()))
+            {
+                return pos_type(off_type(-1));
+            }
+
+            setg(eback(), eback() + offset, egptr());
+            return pos;
+        }
+    };
+
+    StreamBuf _streambuf;
+};
+
+} // namespace ashdb
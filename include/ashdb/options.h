@@ -1,8 +1,83 @@
 #pragma once
+#include <chrono>
+#include <cstdint>
+#include <string>
 
 namespace ashdb
 {
-    
+
+// the in-memory representation of each segment's record offsets
+enum class IndexEncoding
+{
+    // 64-bit offsets, the same as the index files
+    PLAIN,
+
+    // offsets are stored as 32-bit values relative to the start of the
+    // segment, falling back to 64-bit for segments larger than 4GB
+    RELATIVE32,
+
+    // like RELATIVE32 for the active segment, sealed segments are
+    // compressed with Elias-Fano encoding
+    ELIAS_FANO
+};
+
+// what `AshDB::writeAsync` does when its queue is full
+enum class Backpressure
+{
+    // wait until the queue has room for the record
+    BLOCK,
+
+    // return QUEUE_FULL without queuing the record
+    FAIL_FAST,
+
+    // discard the oldest queued record, whose result is DROPPED, to make
+    // room for the new one
+    DROP_OLDEST
+};
+
+// how the records of each segment are compressed
+enum class Compression
+{
+    // records are stored as they were serialized
+    NONE,
+
+    // records are grouped into blocks that are each compressed with the
+    // built-in LZ77 codec, which favours speed over compression ratio
+    LZ
+};
+
+// which records have their checksum verified when they are read, a record
+// whose checksum doesn't match throws std::runtime_error
+enum class ChecksumVerification
+{
+    // none, the checksums are only written
+    NONE,
+
+    // the records of the active segment, which is where a write that was
+    // cut short by a crash ends up
+    ACTIVE_SEGMENT,
+
+    // every record
+    ALL
+};
+
+// when the data and index files are flushed to disk
+enum class SyncPolicy
+{
+    // never, the operating system decides when data reaches the disk
+    NONE,
+
+    // after every append, so every record is on disk once its write returns
+    PER_RECORD,
+
+    // once at the end of every call to `write`
+    PER_BATCH,
+
+    // by a background thread every `sync_interval` or once `sync_bytes`
+    // bytes have been appended since the last sync
+    INTERVAL
+};
+
 struct Options
 {
     bool create_if_missing = true;
@@ -13,6 +88,70 @@ struct Options
 
     std::string prefix = "data";
     std::string extension = "ash";
+
+    // the number of segment data files that are kept open for reading
+    std::size_t read_cache_size = 16;
+
+    // read segments that are no longer being written to through a read-only
+    // memory mapping rather than buffered file I/O
+    bool mmap_sealed_segments = false;
+
+    // the number of records an iterator reads at a time as it moves through
+    // the database, and whether it reads the next batch of records on a
+    // background thread while the current one is being used
+    std::size_t read_ahead_window = 1024;
+    bool read_ahead_prefetch = false;
+
+    IndexEncoding index_encoding = IndexEncoding::RELATIVE32;
+
+    // when every record serializes to the same number of bytes, this is that
+    // number. Segments of fixed width records have no index file and the
+    // offset of each record is calculated. 0 means records vary in size
+    std::uint32_t fixed_record_size = 0;
+
+    // compresses the records of variable size segments in blocks of about
+    // `compression_block_size` uncompressed bytes, a read only decompresses
+    // the blocks that hold the records it needs. Compressed segments are
+    // never memory mapped, and segments of fixed width records are never
+    // compressed. `filesize_max` and `database_max` apply to the compressed
+    // size, except that records that are not in a block yet are counted at
+    // their uncompressed size
+    Compression compression = Compression::NONE;
+    std::size_t compression_block_size = 64 * 1024;
+
+    // store a CRC32C checksum after every record, which is verified on read
+    // as set by `verify_checksums`
+    bool checksums = false;
+    ChecksumVerification verify_checksums = ChecksumVerification::ALL;
+
+    // only read the first entry and size of each index file on open, and
+    // load a segment's offsets the first time one of its records is read
+    bool lazy_index_loading = false;
+
+    // the number of bytes of lazily loaded segment indices to keep in
+    // memory before unloading the least recently used ones, 0 is unlimited
+    std::uint64_t index_memory_budget = 0;
+
+    // the number of records `writeAsync` can queue before applying
+    // `async_backpressure`
+    std::size_t async_queue_size = 1024;
+    Backpressure async_backpressure = Backpressure::BLOCK;
+
+    // the number of bytes of records to buffer in memory before writing them
+    // to the active segment in one call, buffered records can still be read
+    // but are lost if the process dies. 0 writes every record immediately
+    std::size_t write_buffer_size = 0;
+
+    SyncPolicy sync_policy = SyncPolicy::NONE;
+
+    // the time and the number of unsynced bytes after which the active
+    // segment is synced under `SyncPolicy::INTERVAL`, 0 disables either
+    std::chrono::milliseconds sync_interval{ 1000 };
+    std::uint64_t sync_bytes = 0;
+
+    // the number of threads in the pool that runs `parallelForEach` and
+    // `parallelTransformReduce`, 0 starts one per core
+    std::size_t worker_threads = 0;
 };
 
 } // namespace ashdb
\ No newline at end of file
@@ -1,5 +1,11 @@
 #pragma once
 #include <iostream>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+#include "buffer.h"
 
 namespace ashdb
 {
@@ -7,6 +13,27 @@ namespace ashdb
 using PointerType = char*;
 using StrLenType = std::uint32_t;
 
+// Records of the types for which this is true are stored as their raw bytes,
+// so they are written and read with a memcpy instead of `ashdb_write` and
+// `ashdb_read`, and a range of them is read straight into a vector. Integers
+// and doubles are already serialized that way, except for `bool` which has
+// no contiguous `std::vector`. Other trivially copyable types
+// can opt in with a specialization such as
+//
+//     template<> struct ashdb::RawRecord<app::Point> : std::true_type {};
+//
+// which stores the whole struct, padding included, so it is only compatible
+// with existing data when the struct has no padding
+template<typename T>
+struct RawRecord
+    : std::bool_constant<(std::is_integral_v<T> && !std::is_same_v<T, bool>)
+                         || std::is_same_v<T, double>>
+{
+};
+
+template<typename T>
+constexpr bool IsRawRecord = RawRecord<T>::value;
+
 template <typename T,
     typename = typename std::enable_if<(std::is_integral<T>::value)>::type>
 inline void ashdb_write(std::ostream& stream, T value)
@@ -47,4 +74,47 @@ inline void ashdb_read(std::istream& stream, std::string& data)
     stream.read(reinterpret_cast<PointerType>(data.data()), len);
 }
 
+// the same encodings for `BufferWriter` and `BufferReader`, which are used
+// instead of the stream overloads above when a record type supports them
+
+template <typename T,
+    typename = typename std::enable_if<(std::is_integral<T>::value)>::type>
+inline void ashdb_write(BufferWriter& buffer, T value)
+{
+    buffer.write(reinterpret_cast<PointerType>(&value), sizeof(value));
+}
+
+inline void ashdb_write(BufferWriter& buffer, double val)
+{
+    buffer.write(reinterpret_cast<PointerType>(&val), sizeof(double));
+}
+
+inline void ashdb_write(BufferWriter& buffer, std::string_view data)
+{
+    auto size = static_cast<StrLenType>(data.size());
+    ashdb_write<StrLenType>(buffer, size);
+    buffer.write(data.data(), size);
+}
+
+template<typename T,
+    typename = typename std::enable_if<(std::is_integral<T>::value)>::type>
+inline void ashdb_read(BufferReader& buffer, T& value)
+{
+    buffer.read(reinterpret_cast<PointerType>(&value), sizeof(value));
+}
+
+inline void ashdb_read(BufferReader& buffer, double& val)
+{
+    buffer.read(reinterpret_cast<PointerType>(&val), sizeof(double));
+}
+
+inline void ashdb_read(BufferReader& buffer, std::string& data)
+{
+    StrLenType len = 0;
+    ashdb_read(buffer, len);
+
+    data.resize(len);
+    buffer.read(reinterpret_cast<PointerType>(data.data()), len);
+}
+
 } // namespace ashdb
\ No newline at end of file
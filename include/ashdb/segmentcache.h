@@ -0,0 +1,98 @@
+#pragma once
+#include <list>
+#include <unordered_map>
+#include <cstdint>
+#include <utility>
+
+namespace ashdb
+{
+
+// A bounded cache of per-segment resources (i.e. open file handles) keyed by
+// the segment number. When the cache is full the least recently used entry
+// is evicted to make room for the new one
+template<class HandleT>
+class SegmentCache final
+{
+public:
+    using Entry = std::pair<std::uint16_t, HandleT>;
+
+    explicit SegmentCache(std::size_t capacity)
+        : _capacity{ capacity > 0 ? capacity : 1 }
+    {
+    }
+
+    // returns the handle for `segment`, creating it with `factory` if it is
+    // not already cached. If `factory` throws then the cache is left untouched
+    template<class FactoryT>
+    HandleT& get(std::uint16_t segment, FactoryT&& factory)
+    {
+        if (auto it = _lookup.find(segment); it != _lookup.end())
+        {
+            // move the entry to the front of the list since it is now
+            // the most recently used
+            _entries.splice(_entries.begin(), _entries, it->second);
+            return it->second->second;
+        }
+
+        HandleT handle = factory();
+
+        if (_entries.size() >= _capacity)
+        {
+            _lookup.erase(_entries.back().first);
+            _entries.pop_back();
+        }
+
+        _entries.emplace_front(segment, std::move(handle));
+        _lookup[segment] = _entries.begin();
+        return _entries.front().second;
+    }
+
+    // drops the cached handle for `segment`, should be called before the
+    // segment's files are deleted or modified
+    void erase(std::uint16_t segment)
+    {
+        if (auto it = _lookup.find(segment); it != _lookup.end())
+        {
+            _entries.erase(it->second);
+            _lookup.erase(it);
+        }
+    }
+
+    // returns the cached handle for `segment` without changing how recently
+    // it was used, or nullptr if it isn't cached
+    HandleT* find(std::uint16_t segment)
+    {
+        auto it = _lookup.find(segment);
+        return it != _lookup.end() ? &(it->second->second) : nullptr;
+    }
+
+    // removes and returns the least recently used entry, the cache
+    // must not be empty
+    Entry popLeastRecent()
+    {
+        Entry entry = std::move(_entries.back());
+        _lookup.erase(entry.first);
+        _entries.pop_back();
+        return entry;
+    }
+
+    void clear()
+    {
+        _lookup.clear();
+        _entries.clear();
+    }
+
+    std::size_t size() const noexcept { return _entries.size(); }
+    std::size_t capacity() const noexcept { return _capacity; }
+
+private:
+    using EntryList = std::list<Entry>;
+
+    std::size_t     _capacity;
+
+    // the front of the list is the most recently used entry
+    EntryList       _entries;
+    std::unordered_map<std::uint16_t, typename EntryList::iterator> _lookup;
+};
+
+} // namespace ashdb
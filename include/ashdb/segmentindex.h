@@ -0,0 +1,130 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <stdexcept>
+
+#include "eliasfano.h"
+#include "options.h"
+
+namespace ashdb
+{
+
+// The in-memory index of a single segment. Like the index file that backs
+// it, entry 0 is the record number of the segment's first record and every
+// other entry is the offset of a record in the segment's data file.
+//
+// Entries are appended to the active segment in either a 32-bit or 64-bit
+// array depending on the `IndexEncoding`, and a segment that is sealed can
+// be re-encoded with Elias-Fano. The offsets of a sealed segment can also be
+// unloaded, in which case only the record number and count are kept.
+//
+// Segments of fixed width records don't store any offsets at all, since
+// every offset can be calculated from the size of the records
+class SegmentIndex final
+{
+public:
+    explicit SegmentIndex(IndexEncoding encoding = IndexEncoding::RELATIVE32)
+        : _encoding{ encoding },
+          _storage{ encoding == IndexEncoding::PLAIN ? Storage::WIDE : Storage::NARROW }
+    {
+    }
+
+    // builds the index from the raw entries of an index file
+    SegmentIndex(const std::vector<std::size_t>& entries, IndexEncoding encoding);
+
+    // creates the index of a segment holding `count` records starting at
+    // record number `first` without loading any of its offsets
+    static SegmentIndex Unloaded(std::size_t first, std::size_t count, IndexEncoding encoding);
+
+    // creates the index of a segment holding `count` records of `recordSize`
+    // bytes each starting at record number `first`, the first of which is at
+    // offset `dataStart` of the data file
+    static SegmentIndex Fixed(std::size_t first, std::size_t count,
+                              std::size_t dataStart, std::size_t recordSize);
+
+    // appends a raw index entry
+    void push_back(std::size_t entry);
+
+    // returns the raw index entry, i.e. the record number for i == 0
+    // and the record's offset otherwise
+    std::size_t operator[](std::size_t i) const
+    {
+        return i == 0 ? _first : offset(i);
+    }
+
+    std::size_t at(std::size_t i) const;
+
+    std::size_t front() const { return at(0); }
+
+    // returns the offset of the i-th record in the segment's data file
+    std::size_t offset(std::size_t i) const
+    {
+        switch (_storage)
+        {
+            default:
+            case Storage::NARROW:
+                return _narrow[i];
+            case Storage::WIDE:
+                return static_cast<std::size_t>(_wide[i]);
+            case Storage::PACKED:
+                return static_cast<std::size_t>(_packed.at(i));
+            case Storage::FIXED:
+                return _dataStart + (i * _recordSize);
+            case Storage::UNLOADED:
+                throw std::logic_error("segment index offsets are not loaded");
+        }
+    }
+
+    std::size_t size() const noexcept { return _size; }
+    bool empty() const noexcept { return _size == 0; }
+
+    // called once no more entries will be appended to the segment, this
+    // re-encodes the entries with the compact sealed representation
+    void seal();
+
+    // the number of bytes used by the index entries
+    std::size_t memoryUsage() const noexcept;
+
+    bool loaded() const noexcept { return _storage != Storage::UNLOADED; }
+
+    // replaces the offsets of an unloaded index with the raw entries of its
+    // index file, the entries must describe the same records
+    void load(const std::vector<std::size_t>& entries);
+
+    // returns the raw entries, the same as those of the segment's index file
+    std::vector<std::size_t> entries() const;
+
+    // releases the memory used by the offsets but keeps the record number
+    // and count, only sealed segments should be unloaded
+    void unload();
+
+private:
+    enum class Storage
+    {
+        NARROW,
+        WIDE,
+        PACKED,
+        FIXED,
+        UNLOADED
+    };
+
+    // moves the 32-bit offsets to the 64-bit array once an offset is
+    // too large to be stored relative to the start of the segment
+    void widen();
+
+    IndexEncoding               _encoding;
+    Storage                     _storage = Storage::NARROW;
+
+    std::size_t                 _first = 0;
+    std::size_t                 _size = 0;
+
+    // the layout of a segment of fixed width records
+    std::size_t                 _dataStart = 0;
+    std::size_t                 _recordSize = 0;
+
+    std::vector<std::uint32_t>  _narrow;
+    std::vector<std::uint64_t>  _wide;
+    EliasFano                   _packed;
+};
+
+} // namespace ashdb
@@ -1,5 +1,7 @@
 #pragma once
 #include <string>
+#include <optional>
+#include <cstddef>
 
 namespace ashdb
 {
@@ -11,7 +13,11 @@ enum class OpenStatus
     NOT_FOUND,
     INVALID_PREFIX,
     INVALID_EXTENSION,
-    ALREADY_OPEN
+    ALREADY_OPEN,
+
+    // the segments were written with a different compression, checksum or
+    // fixed record size setting than the one the database was opened with
+    FORMAT_MISMATCH
 };
 
 std::string ToString(OpenStatus status);
@@ -20,10 +26,21 @@ enum class WriteStatus
 {
     OK,
     DATABASE_NOT_OPEN,
-    INDEX_FILE_ERROR
+    INDEX_FILE_ERROR,
+    QUEUE_FULL,
+    DROPPED,
+    INVALID_RECORD_SIZE
 };
 
 std::string ToString(WriteStatus status);
 
+// the outcome of an asynchronous write, `index` is the record number that
+// was assigned to the record if it was written
+struct WriteResult
+{
+    WriteStatus                 status = WriteStatus::OK;
+    std::optional<std::size_t>  index;
+};
+
 } // namespace ashdb
 
@@ -0,0 +1,71 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace ashdb
+{
+
+// A fixed set of worker threads with a task queue each. Tasks submitted by a
+// worker go to its own queue and are run newest first, tasks submitted from
+// outside the pool are spread across the queues, and a worker whose queue is
+// empty steals the oldest task of another worker
+class ThreadPool final
+{
+public:
+    // starts `threads` workers, or one per core if `threads` is 0
+    explicit ThreadPool(std::size_t threads = 0);
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // runs every task that is still queued and then joins the workers
+    ~ThreadPool();
+
+    std::size_t size() const noexcept { return _threads.size(); }
+
+    // queues a task, which must not throw
+    void submit(std::function<void()> task);
+
+    // calls `task(i)` for every i in [0, count) with at most `parallelism`
+    // calls running at once, or as many as there are workers if it is 0,
+    // and returns once all of them have finished. The calling thread runs
+    // tasks as well, so this can also be called from inside a task. Once a
+    // task throws no further tasks are started, and the first exception is
+    // rethrown
+    void forEach(std::size_t count, std::size_t parallelism,
+                 const std::function<void(std::size_t)>& task);
+
+private:
+    struct TaskQueue
+    {
+        std::mutex                          mutex;
+        std::deque<std::function<void()>>   tasks;
+    };
+
+    // takes a task from the back of the worker's own queue, or else from
+    // the front of any other queue
+    bool pop(std::size_t worker, std::function<void()>& task);
+
+    void run(std::size_t worker);
+
+    std::vector<std::unique_ptr<TaskQueue>> _queues;
+    std::vector<std::thread>                _threads;
+
+    // the number of queued tasks, which the workers sleep on
+    std::mutex                  _mutex;
+    std::condition_variable     _wake;
+    std::size_t                 _pending = 0;
+    bool                        _stop = false;
+
+    // spreads the tasks submitted from outside the pool over the queues
+    std::atomic<std::size_t>    _nextQueue{ 0 };
+};
+
+} // namespace ashdb
@@ -0,0 +1,195 @@
+#include <cstring>
+#include <exception>
+#include <filesystem>
+
+#include "../include/ashdb/appender.h"
+
+namespace ashdb
+{
+
+void SegmentAppender::open(const std::string& datafile, const std::string& indexfile,
+                           const std::string& indexHeader)
+{
+    close();
+
+    if (_codec != nullptr && std::filesystem::exists(datafile))
+    {
+        // a block that was not completely written when the process died is
+        // cut off, since the records in it were never indexed
+        std::uint64_t size = 0;
+        {
+            File file{ datafile, File::Mode::Read };
+            _blocks = ReadBlockTable(file);
+            size = file.size();
+        }
+
+        if (size != _blocks.fileSize())
+        {
+            std::filesystem::resize_file(datafile, _blocks.fileSize());
+        }
+    }
+
+    _datafile = File{ datafile, File::Mode::Append };
+    _fileSize = _datafile.size();
+    _dataSize = _codec != nullptr ? _blocks.rawSize() : _fileSize;
+
+    if (!indexfile.empty())
+    {
+        _indexfile = File{ indexfile, File::Mode::Append };
+        _indexSize = _indexfile.size();
+
+        // the header is written before any entry, so that the entries of a
+        // segment are never found without it
+        if (_indexSize == 0 && !indexHeader.empty())
+        {
+            _indexfile.write(indexHeader.data(), indexHeader.size());
+            _indexSize = indexHeader.size();
+            _indexHeaderSize = indexHeader.size();
+            _unsyncedBytes += indexHeader.size();
+        }
+        else if (!indexHeader.empty() && _indexSize >= indexHeader.size())
+        {
+            // index files written before they had a header are appended to
+            // without one
+            std::string header(indexHeader.size(), '\0');
+            const File reader{ indexfile, File::Mode::Read };
+            if (reader.read(header.data(), header.size(), 0) == header.size()
+                && std::memcmp(header.data(), indexHeader.data(), header.size()) == 0)
+            {
+                _indexHeaderSize = header.size();
+            }
+        }
+    }
+}
+
+void SegmentAppender::close() noexcept
+{
+    try
+    {
+        flush();
+    }
+    catch (const std::exception&)
+    {
+        // the buffered records are lost, callers that need to know about
+        // it flush before closing
+    }
+
+    _pendingData.clear();
+    _pendingIndex.clear();
+
+    _datafile.close();
+    _indexfile.close();
+    _blocks = {};
+    _dataSize = 0;
+    _fileSize = 0;
+    _indexSize = 0;
+    _indexHeaderSize = 0;
+    _unsyncedBytes = 0;
+}
+
+void SegmentAppender::append(const char* data, std::size_t size,
+                             const std::size_t* index, std::size_t count)
+{
+    _unsyncedBytes += size + (count * sizeof(std::size_t));
+
+    if (_bufferSize > 0)
+    {
+        _pendingData.append(data, size);
+        _pendingIndex.insert(_pendingIndex.end(), index, index + count);
+        if (_pendingData.size() >= _bufferSize)
+        {
+            flush();
+        }
+        return;
+    }
+
+    _datafile.write(data, size);
+    _dataSize += size;
+    _fileSize += size;
+
+    if (_indexfile.isOpen())
+    {
+        const auto indexBytes = count * sizeof(std::size_t);
+        _indexfile.write(reinterpret_cast<const char*>(index), indexBytes);
+        _indexSize += indexBytes;
+    }
+}
+
+void SegmentAppender::flush()
+{
+    if (_pendingData.empty() && _pendingIndex.empty())
+    {
+        return;
+    }
+
+    if (_codec != nullptr)
+    {
+        writeBlocks();
+    }
+    else
+    {
+        _datafile.write(_pendingData.data(), _pendingData.size());
+        _dataSize += _pendingData.size();
+        _fileSize += _pendingData.size();
+    }
+    _pendingData.clear();
+
+    if (_indexfile.isOpen())
+    {
+        const auto indexBytes = _pendingIndex.size() * sizeof(std::size_t);
+        _indexfile.write(reinterpret_cast<const char*>(_pendingIndex.data()), indexBytes);
+        _indexSize += indexBytes;
+    }
+    _pendingIndex.clear();
+}
+
+void SegmentAppender::writeBlocks()
+{
+    if (_pendingData.empty())
+    {
+        return;
+    }
+
+    // the records are split into blocks of about the same size, none of
+    // them smaller than the block size unless everything is
+    const auto count = std::max<std::size_t>(_pendingData.size() / _blockSize, 1);
+    const auto size = (_pendingData.size() + count - 1) / count;
+
+    _blockBuffer.clear();
+    std::vector<std::pair<std::uint32_t, std::uint32_t>> sizes;
+    for (std::size_t offset = 0; offset < _pendingData.size(); offset += size)
+    {
+        const auto rawSize = std::min(size, _pendingData.size() - offset);
+        const auto start = _blockBuffer.size();
+        AppendBlock(*_codec, _pendingData.data() + offset, rawSize, _blockBuffer);
+        sizes.emplace_back(static_cast<std::uint32_t>(_blockBuffer.size() - start - BLOCK_HEADER_SIZE),
+                           static_cast<std::uint32_t>(rawSize));
+    }
+
+    _datafile.write(_blockBuffer.data(), _blockBuffer.size());
+    for (const auto& [storedSize, rawSize] : sizes)
+    {
+        _blocks.push_back(storedSize, rawSize);
+    }
+
+    _dataSize += _pendingData.size();
+    _fileSize += _blockBuffer.size();
+}
+
+void SegmentAppender::sync()
+{
+    if (!isOpen() || _unsyncedBytes == 0)
+    {
+        return;
+    }
+
+    flush();
+    _datafile.sync();
+    if (_indexfile.isOpen())
+    {
+        _indexfile.sync();
+    }
+    _unsyncedBytes = 0;
+}
+
+} // namespace ashdb
@@ -1,3 +1,6 @@
+#include <algorithm>
+#include <charconv>
+#include <cstring>
 #include <limits>
 #include <iomanip>
 
@@ -8,6 +11,82 @@
 namespace ashdb
 {
 
+namespace
+{
+
+// identifies the data file of a segment of fixed width records
+constexpr char FIXED_HEADER_MAGIC[] = "ASHF";
+
+// starts an index file that has a header
+constexpr char INDEX_HEADER_MAGIC[] = "ASHINDEX";
+
+// where the format of a segment is stored in the headers, and its size.
+// The format is a word of flags (the compression in the low byte and then
+// whether there are checksums) followed by the fixed record size
+constexpr std::size_t FIXED_HEADER_FORMAT = 16;
+constexpr std::size_t INDEX_HEADER_FORMAT = 8;
+constexpr std::size_t FORMAT_SIZE = 8;
+constexpr std::uint32_t FORMAT_CHECKSUMS = 0x100;
+
+// ends the data file of a sealed segment
+constexpr char SEGMENT_FOOTER_MAGIC[] = "ASHS";
+
+// the layout of the fixed part of a segment footer, the checksum covers
+// every field before it
+constexpr std::size_t FOOTER_FIRST = 0;
+constexpr std::size_t FOOTER_COUNT = 8;
+constexpr std::size_t FOOTER_DATA_SIZE = 16;
+constexpr std::size_t FOOTER_TABLE_SIZE = 24;
+constexpr std::size_t FOOTER_FLAGS = 32;
+constexpr std::size_t FOOTER_TABLE_CRC = 36;
+constexpr std::size_t FOOTER_CRC = 40;
+constexpr std::size_t FOOTER_MAGIC = 44;
+
+std::uint32_t FormatFlags(Compression compression, bool checksums)
+{
+    return static_cast<std::uint32_t>(compression) | (checksums ? FORMAT_CHECKSUMS : 0);
+}
+
+void WriteFormat(const SegmentFormat& format, char* data)
+{
+    const auto flags = FormatFlags(format.compression, format.checksums);
+    std::memcpy(data, &flags, sizeof(flags));
+    std::memcpy(data + sizeof(flags), &format.fixedRecordSize, sizeof(format.fixedRecordSize));
+}
+
+SegmentFormat ParseFormat(const char* data)
+{
+    std::uint32_t flags = 0;
+    SegmentFormat format;
+    std::memcpy(&flags, data, sizeof(flags));
+    std::memcpy(&format.fixedRecordSize, data + sizeof(flags), sizeof(format.fixedRecordSize));
+    format.compression = static_cast<Compression>(flags & 0xff);
+    format.checksums = (flags & FORMAT_CHECKSUMS) != 0;
+    return format;
+}
+
+// returns the format in the header of an index file, or nothing for index
+// files that were written without one
+std::optional<SegmentFormat> ReadIndexHeader(const File& indexfile)
+{
+    char header[INDEX_HEADER_SIZE];
+    if (indexfile.size() < INDEX_HEADER_SIZE
+        || indexfile.read(header, sizeof(header), 0) != sizeof(header)
+        || std::memcmp(header, INDEX_HEADER_MAGIC, INDEX_HEADER_FORMAT) != 0)
+    {
+        return std::nullopt;
+    }
+
+    return ParseFormat(header + INDEX_HEADER_FORMAT);
+}
+
+std::uint64_t IndexHeaderSize(const std::optional<SegmentFormat>& format)
+{
+    return format.has_value() ? INDEX_HEADER_SIZE : 0;
+}
+
+} // namespace
+
 std::string BuildFilename(const std::string& folder,
                           const std::string& prefix,
                           const std::string& extension,
@@ -30,27 +109,411 @@ std::string BuildFilename(const std::string& folder,
     return path.string();
 }
 
+std::string BuildIndexFileHeader(const SegmentFormat& format)
+{
+    std::string header(INDEX_HEADER_SIZE, '\0');
+    std::memcpy(header.data(), INDEX_HEADER_MAGIC, INDEX_HEADER_FORMAT);
+    WriteFormat(format, header.data() + INDEX_HEADER_FORMAT);
+    return header;
+}
+
 std::vector<std::size_t> ReadIndexFile(const std::string& filename)
 {
-    std::vector<std::size_t> retval;
+    if (!fs::exists(filename))
+    {
+        return {};
+    }
+
+    File indexfile{ filename, File::Mode::Read };
+    const auto headerSize = IndexHeaderSize(ReadIndexHeader(indexfile));
+    const auto filesize = indexfile.size() - headerSize;
+    if (filesize % sizeof(std::size_t) != 0)
+    {
+        std::stringstream error;
+        error << "index file '" << filename << "' has a partial entry, size " << filesize
+              << " is not a multiple of " << sizeof(std::size_t);
+        throw std::runtime_error(error.str());
+    }
+
+    // size the vector from the file length and read all of it at once
+    std::vector<std::size_t> retval(static_cast<std::size_t>(filesize / sizeof(std::size_t)));
+    const auto bytes = retval.size() * sizeof(std::size_t);
+    if (indexfile.read(reinterpret_cast<char*>(retval.data()), bytes, headerSize) != bytes)
+    {
+        throw std::runtime_error("could not read index file '" + filename + "'");
+    }
+
+    // the first entry is a record number and every other entry is an offset
+    // into the data file, so the offsets must never decrease. This loop has
+    // no early exit so that the compiler can vectorize it
+    std::size_t violations = 0;
+    for (std::size_t i = 2; i < retval.size(); ++i)
+    {
+        violations += static_cast<std::size_t>(retval[i] < retval[i - 1]);
+    }
+
+    if (violations > 0)
+    {
+        std::stringstream error;
+        error << "index file '" << filename << "' is corrupt, "
+              << violations << " offsets are out of order";
+        throw std::runtime_error(error.str());
+    }
+
+    return retval;
+}
+
+std::string BuildFixedSegmentHeader(std::size_t first, std::uint32_t recordSize, const SegmentFormat& format)
+{
+    const std::uint64_t firstRecord = first;
 
+    std::string header(FIXED_HEADER_SIZE, '\0');
+    std::memcpy(header.data(), FIXED_HEADER_MAGIC, 4);
+    std::memcpy(header.data() + 4, &recordSize, sizeof(recordSize));
+    std::memcpy(header.data() + 8, &firstRecord, sizeof(firstRecord));
+    WriteFormat(format, header.data() + FIXED_HEADER_FORMAT);
+    return header;
+}
+
+IndexFileSummary ReadFixedSegmentSummary(const std::string& filename, std::uint32_t recordSize)
+{
     if (!fs::exists(filename))
     {
         return {};
     }
 
-    if (std::ifstream ifs(filename.data(), std::ios_base::binary);
-        ifs.is_open())
+    File datafile{ filename, File::Mode::Read };
+    const auto filesize = datafile.size();
+
+    // the magic is checked against as much of the header as was written, a
+    // data file that doesn't start with it holds variable size records
+    IndexFileSummary summary;
+    char header[FIXED_HEADER_SIZE];
+    const auto headerSize = datafile.read(header,
+        static_cast<std::size_t>(std::min<std::uint64_t>(filesize, sizeof(header))), 0);
+    if (std::memcmp(header, FIXED_HEADER_MAGIC, std::min<std::size_t>(headerSize, 4)) != 0)
+    {
+        summary.format = SegmentFormat{};
+        return summary;
+    }
+    else if (headerSize < FIXED_HEADER_SIZE)
+    {
+        return summary;
+    }
+
+    std::uint32_t storedSize = 0;
+    std::uint64_t first = 0;
+    std::memcpy(&storedSize, header + 4, sizeof(storedSize));
+    std::memcpy(&first, header + 8, sizeof(first));
+    summary.format = ParseFormat(header + FIXED_HEADER_FORMAT);
+
+    const auto expectedSize = summary.format->fixedRecordSize
+        + (summary.format->checksums ? static_cast<std::uint32_t>(CHECKSUM_SIZE) : 0u);
+    if (storedSize != expectedSize)
+    {
+        std::stringstream error;
+        error << "data file '" << filename << "' has records of " << storedSize
+              << " bytes but its format is for " << expectedSize;
+        throw std::runtime_error(error.str());
+    }
+    else if (storedSize != recordSize)
     {
-        while (ifs.peek() != EOF)
+        return summary;
+    }
+
+    summary.first = static_cast<std::size_t>(first);
+    summary.count = static_cast<std::size_t>((filesize - FIXED_HEADER_SIZE) / recordSize);
+    return summary;
+}
+
+std::vector<std::uint16_t> FindSegmentNumbers(const std::string& folder,
+                                              const std::string& prefix,
+                                              const std::string& extension)
+{
+    constexpr std::size_t DigitCount = 5;
+
+    std::vector<std::uint16_t> retval;
+
+    std::error_code error;
+    for (const auto& entry : fs::directory_iterator{ folder, error })
+    {
+        // the filename should look like "<prefix>-00001.<extension>"
+        const std::string filename = entry.path().filename().string();
+        if (filename.size() != prefix.size() + DigitCount + extension.size() + 2
+            || filename.compare(0, prefix.size(), prefix) != 0
+            || filename[prefix.size()] != '-'
+            || filename[prefix.size() + DigitCount + 1] != '.'
+            || filename.compare(prefix.size() + DigitCount + 2, extension.size(), extension) != 0)
+        {
+            continue;
+        }
+
+        const char* digits = filename.data() + prefix.size() + 1;
+        std::uint32_t number = 0;
+        const auto [end, ec] = std::from_chars(digits, digits + DigitCount, number);
+        if (ec != std::errc{}
+            || end != digits + DigitCount
+            || number > std::numeric_limits<std::uint16_t>::max())
         {
-            std::size_t value;
-            ashdb_read(ifs, value);
-            retval.push_back(value);
+            continue;
         }
+
+        retval.push_back(static_cast<std::uint16_t>(number));
     }
 
+    std::sort(retval.begin(), retval.end());
     return retval;
 }
 
+IndexFileSummary ReadIndexFileSummary(const std::string& filename)
+{
+    IndexFileSummary summary;
+
+    File indexfile{ filename, File::Mode::Read };
+    summary.format = ReadIndexHeader(indexfile);
+    const auto headerSize = IndexHeaderSize(summary.format);
+    summary.count = static_cast<std::size_t>((indexfile.size() - headerSize) / sizeof(std::size_t));
+    if (summary.count > 0
+        && indexfile.read(reinterpret_cast<char*>(&summary.first), sizeof(summary.first), headerSize)
+            != sizeof(summary.first))
+    {
+        throw std::runtime_error("could not read the first entry of '" + filename + "'");
+    }
+
+    return summary;
+}
+
+IndexFileTail RecoverIndexFile(const std::string& filename, std::uint64_t dataSize, const SegmentFormat& format)
+{
+    IndexFileTail tail;
+    if (!fs::exists(filename))
+    {
+        return tail;
+    }
+
+    std::uint64_t headerSize = 0;
+    std::uint64_t filesize = 0;
+    {
+        File indexfile{ filename, File::Mode::Read };
+        tail.format = ReadIndexHeader(indexfile);
+        if (tail.format.has_value() && *tail.format != format)
+        {
+            return tail;
+        }
+
+        headerSize = IndexHeaderSize(tail.format);
+        filesize = indexfile.size() - headerSize;
+
+        const auto readEntry = [&indexfile, &filename, headerSize](std::size_t entry)
+        {
+            std::size_t value = 0;
+            if (indexfile.read(reinterpret_cast<char*>(&value), sizeof(value), headerSize + (entry * sizeof(value)))
+                != sizeof(value))
+            {
+                throw std::runtime_error("could not read index file '" + filename + "'");
+            }
+            return value;
+        };
+
+        // walk back from the end over the entries of records that never made
+        // it to the data file. The first entry is the record number of a
+        // record at the start of the data file, which is there if it has any bytes
+        auto count = static_cast<std::size_t>(filesize / sizeof(std::size_t));
+        while (count > 1)
+        {
+            tail.lastOffset = readEntry(count - 1);
+            if (tail.lastOffset < dataSize)
+            {
+                break;
+            }
+            tail.lastOffset = 0;
+            --count;
+        }
+
+        if (count == 1 && dataSize == 0)
+        {
+            count = 0;
+        }
+
+        tail.count = count;
+        if (count > 0)
+        {
+            tail.first = readEntry(0);
+        }
+    }
+
+    if (tail.count * sizeof(std::size_t) != filesize)
+    {
+        fs::resize_file(filename, headerSize + (tail.count * sizeof(std::size_t)));
+    }
+
+    return tail;
+}
+
+std::string BuildSegmentFooter(const std::vector<std::size_t>& entries,
+                               std::uint64_t dataSize,
+                               Compression compression,
+                               bool checksums)
+{
+    std::string footer;
+    const auto codec = GetBlockCodec(compression);
+    if (codec == nullptr)
+    {
+        footer.assign(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(std::size_t));
+    }
+    else
+    {
+        // the differences between offsets are the sizes of the records,
+        // which repeat far more often than the offsets themselves
+        std::vector<std::size_t> deltas(entries);
+        for (auto i = deltas.size(); i > 2; --i)
+        {
+            deltas[i - 1] -= entries[i - 2];
+        }
+        AppendBlock(*codec, reinterpret_cast<const char*>(deltas.data()), deltas.size() * sizeof(std::size_t), footer);
+    }
+
+    const std::uint64_t first = entries.empty() ? 0 : entries.front();
+    const std::uint64_t count = entries.size();
+    const std::uint64_t tableSize = footer.size();
+    const auto flags = FormatFlags(codec != nullptr ? compression : Compression::NONE, checksums);
+    const auto tableCrc = Crc32c(footer.data(), footer.size());
+
+    char fixed[SEGMENT_FOOTER_SIZE] = {};
+    std::memcpy(fixed + FOOTER_FIRST, &first, sizeof(first));
+    std::memcpy(fixed + FOOTER_COUNT, &count, sizeof(count));
+    std::memcpy(fixed + FOOTER_DATA_SIZE, &dataSize, sizeof(dataSize));
+    std::memcpy(fixed + FOOTER_TABLE_SIZE, &tableSize, sizeof(tableSize));
+    std::memcpy(fixed + FOOTER_FLAGS, &flags, sizeof(flags));
+    std::memcpy(fixed + FOOTER_TABLE_CRC, &tableCrc, sizeof(tableCrc));
+
+    const auto crc = Crc32c(fixed, FOOTER_CRC);
+    std::memcpy(fixed + FOOTER_CRC, &crc, sizeof(crc));
+    std::memcpy(fixed + FOOTER_MAGIC, SEGMENT_FOOTER_MAGIC, 4);
+
+    footer.append(fixed, SEGMENT_FOOTER_SIZE);
+    return footer;
+}
+
+std::optional<SegmentFooter> ParseSegmentFooter(const char* data, std::uint64_t size)
+{
+    if (size < SEGMENT_FOOTER_SIZE || std::memcmp(data + FOOTER_MAGIC, SEGMENT_FOOTER_MAGIC, 4) != 0)
+    {
+        return std::nullopt;
+    }
+
+    std::uint32_t crc = 0;
+    std::memcpy(&crc, data + FOOTER_CRC, sizeof(crc));
+    if (Crc32c(data, FOOTER_CRC) != crc)
+    {
+        return std::nullopt;
+    }
+
+    std::uint64_t first = 0;
+    std::uint64_t count = 0;
+    std::uint32_t flags = 0;
+
+    SegmentFooter footer;
+    std::memcpy(&first, data + FOOTER_FIRST, sizeof(first));
+    std::memcpy(&count, data + FOOTER_COUNT, sizeof(count));
+    std::memcpy(&footer.dataSize, data + FOOTER_DATA_SIZE, sizeof(footer.dataSize));
+    std::memcpy(&footer.tableSize, data + FOOTER_TABLE_SIZE, sizeof(footer.tableSize));
+    std::memcpy(&flags, data + FOOTER_FLAGS, sizeof(flags));
+    std::memcpy(&footer.tableCrc, data + FOOTER_TABLE_CRC, sizeof(footer.tableCrc));
+
+    footer.first = static_cast<std::size_t>(first);
+    footer.count = static_cast<std::size_t>(count);
+    footer.compression = static_cast<Compression>(flags & 0xff);
+    footer.checksums = (flags & FORMAT_CHECKSUMS) != 0;
+
+    // a footer that was found at the end of the file must also fit in it
+    if (footer.dataSize > size - SEGMENT_FOOTER_SIZE
+        || footer.tableSize != size - SEGMENT_FOOTER_SIZE - footer.dataSize)
+    {
+        return std::nullopt;
+    }
+
+    return footer;
+}
+
+std::optional<SegmentFooter> ReadSegmentFooter(const File& file)
+{
+    const auto size = file.size();
+    char fixed[SEGMENT_FOOTER_SIZE];
+    if (size < SEGMENT_FOOTER_SIZE
+        || file.read(fixed, SEGMENT_FOOTER_SIZE, size - SEGMENT_FOOTER_SIZE) != SEGMENT_FOOTER_SIZE)
+    {
+        return std::nullopt;
+    }
+
+    return ParseSegmentFooter(fixed, size);
+}
+
+std::vector<std::size_t> ReadSegmentFooterEntries(const File& file, const SegmentFooter& footer)
+{
+    const auto fail = [&file](const std::string& reason)
+    {
+        throw std::runtime_error("footer of '" + file.filename() + "' " + reason);
+    };
+
+    std::string table(static_cast<std::size_t>(footer.tableSize), '\0');
+    if (file.read(table.data(), table.size(), footer.dataSize) != table.size())
+    {
+        fail("could not be read");
+    }
+
+    if (Crc32c(table.data(), table.size()) != footer.tableCrc)
+    {
+        fail("does not match its checksum");
+    }
+
+    std::vector<std::size_t> entries(footer.count);
+    const auto bytes = entries.size() * sizeof(std::size_t);
+    if (footer.compression == Compression::NONE)
+    {
+        if (table.size() != bytes)
+        {
+            fail("has an offset table of the wrong size");
+        }
+        std::memcpy(entries.data(), table.data(), bytes);
+        return entries;
+    }
+
+    const auto codec = GetBlockCodec(footer.compression);
+    std::uint32_t stored = 0;
+    std::uint32_t raw = 0;
+    if (codec == nullptr || table.size() < BLOCK_HEADER_SIZE)
+    {
+        fail("has an unknown offset table");
+    }
+
+    std::memcpy(&stored, table.data(), sizeof(stored));
+    std::memcpy(&raw, table.data() + sizeof(stored), sizeof(raw));
+    if (raw != bytes || stored != table.size() - BLOCK_HEADER_SIZE)
+    {
+        fail("has an offset table of the wrong size");
+    }
+
+    DecodeBlock(*codec, table.data() + BLOCK_HEADER_SIZE, stored, reinterpret_cast<char*>(entries.data()), bytes);
+    for (std::size_t i = 2; i < entries.size(); ++i)
+    {
+        entries[i] += entries[i - 1];
+    }
+
+    return entries;
+}
+
+std::optional<SegmentFormat> ReadFixedSegmentFormat(const File& file)
+{
+    char header[FIXED_HEADER_SIZE];
+    if (file.size() < FIXED_HEADER_SIZE
+        || file.read(header, sizeof(header), 0) != sizeof(header)
+        || std::memcmp(header, FIXED_HEADER_MAGIC, 4) != 0)
+    {
+        return std::nullopt;
+    }
+
+    return ParseFormat(header + FIXED_HEADER_FORMAT);
+}
+
 } // namespace ashdb
@@ -0,0 +1,361 @@
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <filesystem>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+
+#include "../include/ashdb/compression.h"
+
+namespace ashdb
+{
+
+namespace fs = std::filesystem;
+
+namespace
+{
+
+// matches shorter than this are stored as literals
+constexpr std::size_t MIN_MATCH = 4;
+
+// the farthest back a match can start, which fits in the 16-bit offset
+constexpr std::size_t MAX_OFFSET = 65535;
+
+// the hash table of 4 byte prefixes has 2^HASH_BITS entries
+constexpr std::size_t HASH_BITS = 14;
+
+// a length that doesn't fit in its half of the token is continued in bytes
+// that are added to it, with 255 meaning another byte follows
+constexpr std::size_t TOKEN_LENGTH_MAX = 15;
+
+std::uint32_t Read32(const char* data)
+{
+    std::uint32_t value;
+    std::memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+std::uint32_t HashPrefix(std::uint32_t prefix)
+{
+    return (prefix * 2654435761u) >> (32 - HASH_BITS);
+}
+
+void WriteLength(std::size_t length, std::string& out)
+{
+    for (; length >= 255; length -= 255)
+    {
+        out.push_back(static_cast<char>(255));
+    }
+    out.push_back(static_cast<char>(length));
+}
+
+// writes a sequence of literals followed by a match, the last sequence of a
+// block has no match which is written as a `matchLength` of 0
+void WriteSequence(const char* literals, std::size_t literalCount,
+                   std::size_t offset, std::size_t matchLength, std::string& out)
+{
+    const auto literalToken = std::min(literalCount, TOKEN_LENGTH_MAX);
+    const auto matchToken = matchLength > 0 ? std::min(matchLength - MIN_MATCH, TOKEN_LENGTH_MAX) : 0;
+    out.push_back(static_cast<char>((literalToken << 4) | matchToken));
+
+    if (literalToken == TOKEN_LENGTH_MAX)
+    {
+        WriteLength(literalCount - TOKEN_LENGTH_MAX, out);
+    }
+    out.append(literals, literalCount);
+
+    if (matchLength > 0)
+    {
+        out.push_back(static_cast<char>(offset & 0xFF));
+        out.push_back(static_cast<char>(offset >> 8));
+        if (matchToken == TOKEN_LENGTH_MAX)
+        {
+            WriteLength(matchLength - MIN_MATCH - TOKEN_LENGTH_MAX, out);
+        }
+    }
+}
+
+[[noreturn]] void ThrowCorruptBlock()
+{
+    throw std::runtime_error("compressed block is corrupt");
+}
+
+} // namespace
+
+void LZCodec::compress(const char* data, std::size_t size, std::string& out) const
+{
+    // the table holds the position of each prefix plus one, so that 0 is empty
+    thread_local std::vector<std::uint32_t> table;
+    table.assign(std::size_t{ 1 } << HASH_BITS, 0);
+
+    std::size_t anchor = 0;
+    std::size_t position = 0;
+    while (position + MIN_MATCH <= size)
+    {
+        const auto prefix = Read32(data + position);
+        auto& slot = table[HashPrefix(prefix)];
+        const std::size_t candidate = slot;
+        slot = static_cast<std::uint32_t>(position + 1);
+
+        if (candidate == 0
+            || position - (candidate - 1) > MAX_OFFSET
+            || Read32(data + candidate - 1) != prefix)
+        {
+            // data without matches is skipped over faster the longer the
+            // run of literals gets
+            position += 1 + ((position - anchor) >> 6);
+            continue;
+        }
+
+        const auto match = candidate - 1;
+        auto length = MIN_MATCH;
+        while (position + length < size && data[match + length] == data[position + length])
+        {
+            ++length;
+        }
+
+        WriteSequence(data + anchor, position - anchor, position - match, length, out);
+        position += length;
+        anchor = position;
+    }
+
+    WriteSequence(data + anchor, size - anchor, 0, 0, out);
+}
+
+void LZCodec::decompress(const char* data, std::size_t size,
+                         char* out, std::size_t rawSize) const
+{
+    const auto* in = reinterpret_cast<const unsigned char*>(data);
+    const auto* const inEnd = in + size;
+    char* op = out;
+    char* const outEnd = out + rawSize;
+
+    const auto readLength = [&in, inEnd](std::size_t length)
+    {
+        if (length == TOKEN_LENGTH_MAX)
+        {
+            unsigned char next = 255;
+            while (next == 255)
+            {
+                if (in == inEnd)
+                {
+                    ThrowCorruptBlock();
+                }
+                next = *in++;
+                length += next;
+            }
+        }
+        return length;
+    };
+
+    while (true)
+    {
+        if (in == inEnd)
+        {
+            ThrowCorruptBlock();
+        }
+
+        const auto token = *in++;
+        const auto literals = readLength(token >> 4);
+        if (literals > static_cast<std::size_t>(inEnd - in)
+            || literals > static_cast<std::size_t>(outEnd - op))
+        {
+            ThrowCorruptBlock();
+        }
+
+        std::memcpy(op, in, literals);
+        op += literals;
+        in += literals;
+
+        // only the last sequence has no match
+        if (in == inEnd)
+        {
+            break;
+        }
+
+        if (inEnd - in < 2)
+        {
+            ThrowCorruptBlock();
+        }
+
+        const std::size_t offset = in[0] | (static_cast<std::size_t>(in[1]) << 8);
+        in += 2;
+
+        const auto length = readLength(token & 0x0F) + MIN_MATCH;
+        if (offset == 0
+            || offset > static_cast<std::size_t>(op - out)
+            || length > static_cast<std::size_t>(outEnd - op))
+        {
+            ThrowCorruptBlock();
+        }
+
+        // a match that overlaps the bytes it produces repeats them
+        const char* match = op - offset;
+        if (offset >= length)
+        {
+            std::memcpy(op, match, length);
+            op += length;
+        }
+        else
+        {
+            for (std::size_t i = 0; i < length; ++i)
+            {
+                *op++ = *match++;
+            }
+        }
+    }
+
+    if (op != outEnd)
+    {
+        ThrowCorruptBlock();
+    }
+}
+
+const BlockCodec* GetBlockCodec(Compression compression)
+{
+    static const LZCodec lz;
+
+    switch (compression)
+    {
+        case Compression::NONE:
+            break;
+
+        case Compression::LZ:
+            return &lz;
+    }
+
+    return nullptr;
+}
+
+void AppendBlock(const BlockCodec& codec, const char* data, std::size_t size, std::string& out)
+{
+    if (size == 0 || size > std::numeric_limits<std::uint32_t>::max())
+    {
+        throw std::runtime_error("block of " + std::to_string(size) + " bytes cannot be stored");
+    }
+
+    const auto headerStart = out.size();
+    out.resize(headerStart + BLOCK_HEADER_SIZE);
+    codec.compress(data, size, out);
+
+    auto storedSize = out.size() - headerStart - BLOCK_HEADER_SIZE;
+    if (storedSize >= size)
+    {
+        out.resize(headerStart + BLOCK_HEADER_SIZE);
+        out.append(data, size);
+        storedSize = size;
+    }
+
+    const auto stored = static_cast<std::uint32_t>(storedSize);
+    const auto raw = static_cast<std::uint32_t>(size);
+    std::memcpy(out.data() + headerStart, &stored, sizeof(stored));
+    std::memcpy(out.data() + headerStart + sizeof(stored), &raw, sizeof(raw));
+}
+
+void DecodeBlock(const BlockCodec& codec, const char* data, std::size_t storedSize,
+                 char* out, std::size_t rawSize)
+{
+    if (storedSize == rawSize)
+    {
+        std::memcpy(out, data, rawSize);
+        return;
+    }
+
+    codec.decompress(data, storedSize, out, rawSize);
+}
+
+void BlockTable::push_back(std::uint32_t storedSize, std::uint32_t rawSize)
+{
+    _rawStarts.push_back(_rawSize);
+    _fileStarts.push_back(_fileSize);
+    _rawSize += rawSize;
+    _fileSize += BLOCK_HEADER_SIZE + storedSize;
+}
+
+std::size_t BlockTable::find(std::uint64_t offset) const
+{
+    const auto it = std::upper_bound(_rawStarts.begin(), _rawStarts.end(), offset);
+    return static_cast<std::size_t>(std::distance(_rawStarts.begin(), it)) - 1;
+}
+
+BlockTable ReadBlockTable(const File& file)
+{
+    return ReadBlockTable(file, file.size());
+}
+
+BlockTable ReadBlockTable(const File& file, std::uint64_t size)
+{
+    BlockTable blocks;
+
+    char header[BLOCK_HEADER_SIZE];
+    while (blocks.fileSize() + BLOCK_HEADER_SIZE <= size
+        && file.read(header, BLOCK_HEADER_SIZE, blocks.fileSize()) == BLOCK_HEADER_SIZE)
+    {
+        std::uint32_t stored = 0;
+        std::uint32_t raw = 0;
+        std::memcpy(&stored, header, sizeof(stored));
+        std::memcpy(&raw, header + sizeof(stored), sizeof(raw));
+
+        // a block never grows, so anything else is what is left of a
+        // block that was not completely written
+        if (raw == 0 || stored > raw
+            || blocks.fileSize() + BLOCK_HEADER_SIZE + stored > size)
+        {
+            break;
+        }
+
+        blocks.push_back(stored, raw);
+    }
+
+    return blocks;
+}
+
+void TruncateBlocks(const std::string& filename, std::uint64_t rawSize, const BlockCodec& codec)
+{
+    // the blocks that are kept in full and the new last block, if any
+    std::uint64_t keptSize = 0;
+    std::string lastBlock;
+    {
+        File file{ filename, File::Mode::Read };
+        const auto blocks = ReadBlockTable(file);
+        keptSize = blocks.fileSize();
+
+        if (rawSize < blocks.rawSize())
+        {
+            const auto block = blocks.find(rawSize);
+            keptSize = blocks.fileStart(block);
+
+            if (rawSize > blocks.rawStart(block))
+            {
+                const auto start = blocks.fileStart(block) + BLOCK_HEADER_SIZE;
+                std::string stored(static_cast<std::size_t>(blocks.fileEnd(block) - start), '\0');
+                if (file.read(stored.data(), stored.size(), start) != stored.size())
+                {
+                    std::stringstream ss;
+                    ss << "could not read the block at offset " << blocks.fileStart(block) << " of " << filename;
+                    throw std::runtime_error(ss.str());
+                }
+
+                std::string raw(static_cast<std::size_t>(blocks.rawEnd(block) - blocks.rawStart(block)), '\0');
+                DecodeBlock(codec, stored.data(), stored.size(), raw.data(), raw.size());
+                AppendBlock(codec, raw.data(), static_cast<std::size_t>(rawSize - blocks.rawStart(block)), lastBlock);
+            }
+        }
+    }
+
+    fs::resize_file(filename, keptSize);
+    if (!lastBlock.empty())
+    {
+        File file{ filename, File::Mode::Append };
+        file.write(lastBlock.data(), lastBlock.size());
+    }
+}
+
+std::uint64_t NextBlockGeneration()
+{
+    static std::atomic<std::uint64_t> generation{ 0 };
+    return ++generation;
+}
+
+} // namespace ashdb
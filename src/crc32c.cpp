@@ -0,0 +1,145 @@
+#include <array>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#   define ASHDB_CRC32C_SSE42
+#   include <nmmintrin.h>
+#   ifdef _MSC_VER
+#       include <intrin.h>
+#   endif
+#endif
+
+#include "../include/ashdb/crc32c.h"
+
+namespace ashdb
+{
+
+namespace
+{
+
+// the reflected Castagnoli polynomial
+constexpr std::uint32_t POLYNOMIAL = 0x82F63B78;
+
+// slicing-by-8 tables, table[0] is the usual byte at a time table and
+// table[k] advances a byte that is followed by k more bytes
+using Tables = std::array<std::array<std::uint32_t, 256>, 8>;
+
+Tables BuildTables()
+{
+    Tables tables{};
+    for (std::uint32_t i = 0; i < 256; ++i)
+    {
+        auto crc = i;
+        for (auto bit = 0; bit < 8; ++bit)
+        {
+            crc = (crc >> 1) ^ ((crc & 1) ? POLYNOMIAL : 0);
+        }
+        tables[0][i] = crc;
+    }
+
+    for (std::uint32_t i = 0; i < 256; ++i)
+    {
+        for (std::size_t k = 1; k < tables.size(); ++k)
+        {
+            const auto previous = tables[k - 1][i];
+            tables[k][i] = (previous >> 8) ^ tables[0][previous & 0xFF];
+        }
+    }
+
+    return tables;
+}
+
+std::uint32_t SoftwareCrc(std::uint32_t crc, const unsigned char* data, std::size_t size)
+{
+    static const Tables tables = BuildTables();
+
+    for (; size >= 8; size -= 8, data += 8)
+    {
+        std::uint32_t low;
+        std::uint32_t high;
+        std::memcpy(&low, data, sizeof(low));
+        std::memcpy(&high, data + 4, sizeof(high));
+
+        // the tables are built for little endian loads
+        low ^= crc;
+        crc = tables[7][low & 0xFF] ^ tables[6][(low >> 8) & 0xFF]
+            ^ tables[5][(low >> 16) & 0xFF] ^ tables[4][low >> 24]
+            ^ tables[3][high & 0xFF] ^ tables[2][(high >> 8) & 0xFF]
+            ^ tables[1][(high >> 16) & 0xFF] ^ tables[0][high >> 24];
+    }
+
+    for (; size > 0; --size, ++data)
+    {
+        crc = (crc >> 8) ^ tables[0][(crc ^ *data) & 0xFF];
+    }
+
+    return crc;
+}
+
+#ifdef ASHDB_CRC32C_SSE42
+
+#if defined(__GNUC__) || defined(__clang__)
+__attribute__((target("sse4.2")))
+#endif
+std::uint32_t HardwareCrc(std::uint32_t crc, const unsigned char* data, std::size_t size)
+{
+    std::uint64_t crc64 = crc;
+    for (; size >= 8; size -= 8, data += 8)
+    {
+        std::uint64_t value;
+        std::memcpy(&value, data, sizeof(value));
+        crc64 = _mm_crc32_u64(crc64, value);
+    }
+
+    crc = static_cast<std::uint32_t>(crc64);
+    for (; size > 0; --size, ++data)
+    {
+        crc = _mm_crc32_u8(crc, *data);
+    }
+
+    return crc;
+}
+
+bool HasSse42()
+{
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 1);
+    return (info[2] & (1 << 20)) != 0;
+#else
+    return __builtin_cpu_supports("sse4.2");
+#endif
+}
+
+#endif
+
+} // namespace
+
+std::uint32_t Crc32c(const char* data, std::size_t size, std::uint32_t crc)
+{
+#ifdef ASHDB_CRC32C_SSE42
+    static const bool accelerated = HasSse42();
+    if (accelerated)
+    {
+        return ~HardwareCrc(~crc, reinterpret_cast<const unsigned char*>(data), size);
+    }
+#endif
+
+    return Crc32cPortable(data, size, crc);
+}
+
+std::uint32_t Crc32cPortable(const char* data, std::size_t size, std::uint32_t crc)
+{
+    return ~SoftwareCrc(~crc, reinterpret_cast<const unsigned char*>(data), size);
+}
+
+bool Crc32cAccelerated()
+{
+#ifdef ASHDB_CRC32C_SSE42
+    return HasSse42();
+#else
+    return false;
+#endif
+}
+
+} // namespace ashdb
@@ -0,0 +1,172 @@
+#include <cassert>
+#include <stdexcept>
+
+#ifdef _MSC_VER
+#   include <intrin.h>
+#endif
+
+#include "../include/ashdb/eliasfano.h"
+
+namespace ashdb
+{
+
+namespace
+{
+
+constexpr std::size_t SampleRate = 256;
+constexpr std::size_t WordBits = 64;
+
+inline std::uint32_t PopCount(std::uint64_t x)
+{
+#ifdef _MSC_VER
+    return static_cast<std::uint32_t>(__popcnt64(x));
+#else
+    return static_cast<std::uint32_t>(__builtin_popcountll(x));
+#endif
+}
+
+inline std::uint32_t TrailingZeros(std::uint64_t x)
+{
+    assert(x != 0);
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward64(&index, x);
+    return static_cast<std::uint32_t>(index);
+#else
+    return static_cast<std::uint32_t>(__builtin_ctzll(x));
+#endif
+}
+
+// returns the position of the r-th (0-based) set bit in `word`
+inline std::uint32_t SelectInWord(std::uint64_t word, std::uint32_t r)
+{
+    for (; r > 0; --r)
+    {
+        word &= word - 1;
+    }
+    return TrailingZeros(word);
+}
+
+inline std::uint32_t BitWidth(std::uint64_t x)
+{
+    std::uint32_t width = 0;
+    for (; x > 0; x >>= 1)
+    {
+        width++;
+    }
+    return width;
+}
+
+} // namespace
+
+EliasFano::EliasFano(const std::vector<std::uint64_t>& values)
+    : _size{ values.size() }
+{
+    if (values.empty())
+    {
+        return;
+    }
+
+    const std::uint64_t universe = values.back() + 1;
+    const std::uint64_t ratio = universe / _size;
+    _lowBits = ratio > 1 ? BitWidth(ratio) - 1 : 0;
+
+    const std::uint64_t lowMask = _lowBits > 0 ? (~std::uint64_t{0} >> (WordBits - _lowBits)) : 0;
+    const std::size_t highBits = _size + static_cast<std::size_t>(values.back() >> _lowBits) + 1;
+
+    _low.assign((_size * _lowBits + WordBits - 1) / WordBits, 0);
+    _high.assign((highBits + WordBits - 1) / WordBits, 0);
+    _samples.reserve(_size / SampleRate + 1);
+
+    std::uint64_t previous = 0;
+    for (std::size_t i = 0; i < _size; ++i)
+    {
+        const auto value = values[i];
+        if (value < previous)
+        {
+            throw std::runtime_error("elias-fano values must be non-decreasing");
+        }
+        previous = value;
+
+        if (_lowBits > 0)
+        {
+            const auto low = value & lowMask;
+            const std::size_t bit = i * _lowBits;
+            const std::size_t word = bit / WordBits;
+            const std::size_t shift = bit % WordBits;
+
+            _low[word] |= low << shift;
+            if (shift + _lowBits > WordBits)
+            {
+                _low[word + 1] |= low >> (WordBits - shift);
+            }
+        }
+
+        const std::size_t position = static_cast<std::size_t>(value >> _lowBits) + i;
+        _high[position / WordBits] |= std::uint64_t{1} << (position % WordBits);
+
+        if (i % SampleRate == 0)
+        {
+            _samples.push_back(position);
+        }
+    }
+}
+
+std::uint64_t EliasFano::at(std::size_t i) const
+{
+    if (i >= _size)
+    {
+        throw std::out_of_range("elias-fano index out of range");
+    }
+
+    const std::uint64_t high = select(i) - i;
+
+    std::uint64_t low = 0;
+    if (_lowBits > 0)
+    {
+        const std::uint64_t lowMask = ~std::uint64_t{0} >> (WordBits - _lowBits);
+        const std::size_t bit = i * _lowBits;
+        const std::size_t word = bit / WordBits;
+        const std::size_t shift = bit % WordBits;
+
+        low = _low[word] >> shift;
+        if (shift + _lowBits > WordBits)
+        {
+            low |= _low[word + 1] << (WordBits - shift);
+        }
+        low &= lowMask;
+    }
+
+    return (high << _lowBits) | low;
+}
+
+std::size_t EliasFano::select(std::size_t i) const
+{
+    // start at the closest sampled set bit and count the remaining set bits
+    // a whole word at a time
+    const std::size_t sampled = _samples[i / SampleRate];
+    auto remaining = static_cast<std::uint32_t>(i % SampleRate);
+
+    std::size_t word = sampled / WordBits;
+    std::uint64_t bits = _high[word] & (~std::uint64_t{0} << (sampled % WordBits));
+
+    for (;;)
+    {
+        const auto count = PopCount(bits);
+        if (remaining < count)
+        {
+            return word * WordBits + SelectInWord(bits, remaining);
+        }
+
+        remaining -= count;
+        bits = _high[++word];
+    }
+}
+
+std::size_t EliasFano::memoryUsage() const noexcept
+{
+    return sizeof(*this)
+        + (_low.capacity() + _high.capacity() + _samples.capacity()) * sizeof(std::uint64_t);
+}
+
+} // namespace ashdb
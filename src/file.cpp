@@ -0,0 +1,225 @@
+#include <algorithm>
+#include <sstream>
+#include <stdexcept>
+#include <cstring>
+#include <cerrno>
+#include <utility>
+
+#ifdef _WIN32
+#   ifndef NOMINMAX
+#       define NOMINMAX
+#   endif
+#   include <windows.h>
+#else
+#   include <fcntl.h>
+#   include <unistd.h>
+#   include <sys/stat.h>
+#endif
+
+#include "../include/ashdb/file.h"
+
+namespace ashdb
+{
+
+namespace
+{
+
+[[noreturn]] void ThrowFileError(const std::string& what, const std::string& filename)
+{
+    std::stringstream error;
+#ifdef _WIN32
+    error << what << " '" << filename << "' failed with error " << ::GetLastError();
+#else
+    error << what << " '" << filename << "' failed: " << std::strerror(errno);
+#endif
+    throw std::runtime_error(error.str());
+}
+
+} // namespace
+
+File::File(const std::string& filename, Mode mode)
+    : _filename{ filename }
+{
+#ifdef _WIN32
+    const DWORD access = (mode == Mode::Append) ? FILE_APPEND_DATA : GENERIC_READ;
+    const DWORD disposition = (mode == Mode::Append) ? OPEN_ALWAYS : OPEN_EXISTING;
+    HANDLE handle = ::CreateFileA(filename.c_str(), access,
+                        FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                        nullptr, disposition, FILE_ATTRIBUTE_NORMAL, nullptr);
+
+    if (handle == INVALID_HANDLE_VALUE)
+    {
+        ThrowFileError("opening", filename);
+    }
+
+    _handle = handle;
+#else
+    const int flags = (mode == Mode::Append)
+                      ? (O_WRONLY | O_CREAT | O_APPEND)
+                      : O_RDONLY;
+
+    _fd = ::open(filename.c_str(), flags | O_CLOEXEC, 0644);
+    if (_fd < 0)
+    {
+        ThrowFileError("opening", filename);
+    }
+#endif
+}
+
+File::File(File&& other) noexcept
+{
+    *this = std::move(other);
+}
+
+File& File::operator=(File&& other) noexcept
+{
+    if (this != &other)
+    {
+        close();
+        _filename = std::move(other._filename);
+#ifdef _WIN32
+        _handle = other._handle;
+        other._handle = nullptr;
+#else
+        _fd = other._fd;
+        other._fd = -1;
+#endif
+    }
+    return *this;
+}
+
+File::~File()
+{
+    close();
+}
+
+bool File::isOpen() const noexcept
+{
+#ifdef _WIN32
+    return _handle != nullptr;
+#else
+    return _fd >= 0;
+#endif
+}
+
+void File::close() noexcept
+{
+#ifdef _WIN32
+    if (_handle != nullptr)
+    {
+        ::CloseHandle(_handle);
+        _handle = nullptr;
+    }
+#else
+    if (_fd >= 0)
+    {
+        ::close(_fd);
+        _fd = -1;
+    }
+#endif
+}
+
+void File::write(const char* data, std::size_t size)
+{
+    while (size > 0)
+    {
+#ifdef _WIN32
+        const auto chunk = static_cast<DWORD>(std::min<std::size_t>(size, 0x40000000u));
+        DWORD written = 0;
+        if (!::WriteFile(_handle, data, chunk, &written, nullptr))
+        {
+            ThrowFileError("writing", _filename);
+        }
+#else
+        const auto written = ::write(_fd, data, size);
+        if (written < 0)
+        {
+            if (errno == EINTR) continue;
+            ThrowFileError("writing", _filename);
+        }
+#endif
+        data += written;
+        size -= static_cast<std::size_t>(written);
+    }
+}
+
+std::size_t File::read(char* data, std::size_t size, std::uint64_t offset) const
+{
+    std::size_t total = 0;
+    while (total < size)
+    {
+#ifdef _WIN32
+        OVERLAPPED overlapped{};
+        const auto position = offset + total;
+        overlapped.Offset = static_cast<DWORD>(position & 0xFFFFFFFFu);
+        overlapped.OffsetHigh = static_cast<DWORD>(position >> 32);
+
+        const auto chunk = static_cast<DWORD>(std::min<std::size_t>(size - total, 0x40000000u));
+        DWORD count = 0;
+        if (!::ReadFile(_handle, data + total, chunk, &count, &overlapped))
+        {
+            if (::GetLastError() == ERROR_HANDLE_EOF) break;
+            ThrowFileError("reading", _filename);
+        }
+#else
+        const auto count = ::pread(_fd, data + total, size - total,
+                                   static_cast<off_t>(offset + total));
+        if (count < 0)
+        {
+            if (errno == EINTR) continue;
+            ThrowFileError("reading", _filename);
+        }
+#endif
+        if (count == 0)
+        {
+            break;
+        }
+
+        total += static_cast<std::size_t>(count);
+    }
+
+    return total;
+}
+
+void File::sync()
+{
+#ifdef _WIN32
+    if (!::FlushFileBuffers(_handle))
+    {
+        ThrowFileError("syncing", _filename);
+    }
+#elif defined(__APPLE__)
+    if (::fsync(_fd) != 0)
+    {
+        ThrowFileError("syncing", _filename);
+    }
+#else
+    // the file's metadata only matters as far as its size, which
+    // fdatasync flushes as well
+    if (::fdatasync(_fd) != 0)
+    {
+        ThrowFileError("syncing", _filename);
+    }
+#endif
+}
+
+std::uint64_t File::size() const
+{
+#ifdef _WIN32
+    LARGE_INTEGER size;
+    if (!::GetFileSizeEx(_handle, &size))
+    {
+        ThrowFileError("reading size of", _filename);
+    }
+    return static_cast<std::uint64_t>(size.QuadPart);
+#else
+    struct stat st;
+    if (::fstat(_fd, &st) != 0)
+    {
+        ThrowFileError("reading size of", _filename);
+    }
+    return static_cast<std::uint64_t>(st.st_size);
+#endif
+}
+
+} // namespace ashdb
@@ -0,0 +1,141 @@
+#include <sstream>
+#include <stdexcept>
+#include <cstring>
+#include <cerrno>
+
+#ifdef _WIN32
+#   ifndef NOMINMAX
+#       define NOMINMAX
+#   endif
+#   include <windows.h>
+#else
+#   include <fcntl.h>
+#   include <unistd.h>
+#   include <sys/mman.h>
+#   include <sys/stat.h>
+#endif
+
+#include "../include/ashdb/mappedfile.h"
+
+namespace ashdb
+{
+
+namespace
+{
+
+[[noreturn]] void ThrowMappingError(const std::string& what, const std::string& filename)
+{
+    std::stringstream error;
+#ifdef _WIN32
+    error << what << " '" << filename << "' failed with error " << ::GetLastError();
+#else
+    error << what << " '" << filename << "' failed: " << std::strerror(errno);
+#endif
+    throw std::runtime_error(error.str());
+}
+
+} // namespace
+
+#ifdef _WIN32
+
+MappedFile::MappedFile(const std::string& filename)
+{
+    HANDLE file = ::CreateFileA(filename.c_str(), GENERIC_READ,
+                    FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                    nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        ThrowMappingError("opening", filename);
+    }
+
+    LARGE_INTEGER size;
+    if (!::GetFileSizeEx(file, &size))
+    {
+        ::CloseHandle(file);
+        ThrowMappingError("reading size of", filename);
+    }
+
+    _size = static_cast<std::size_t>(size.QuadPart);
+    if (_size > 0)
+    {
+        _mapping = ::CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (_mapping == nullptr)
+        {
+            ::CloseHandle(file);
+            ThrowMappingError("mapping", filename);
+        }
+
+        _data = static_cast<const char*>(::MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0));
+        if (_data == nullptr)
+        {
+            ::CloseHandle(_mapping);
+            ::CloseHandle(file);
+            ThrowMappingError("mapping", filename);
+        }
+    }
+
+    // the mapping keeps its own reference to the file
+    ::CloseHandle(file);
+}
+
+MappedFile::~MappedFile()
+{
+    if (_data != nullptr)
+    {
+        ::UnmapViewOfFile(_data);
+    }
+
+    if (_mapping != nullptr)
+    {
+        ::CloseHandle(_mapping);
+    }
+}
+
+#else
+
+MappedFile::MappedFile(const std::string& filename)
+{
+    const int fd = ::open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        ThrowMappingError("opening", filename);
+    }
+
+    struct stat st;
+    if (::fstat(fd, &st) != 0)
+    {
+        ::close(fd);
+        ThrowMappingError("reading size of", filename);
+    }
+
+    // mmap() fails on zero length mappings, so an empty file is represented
+    // by a null pointer and a size of zero
+    _size = static_cast<std::size_t>(st.st_size);
+    if (_size > 0)
+    {
+        void* addr = ::mmap(nullptr, _size, PROT_READ, MAP_SHARED, fd, 0);
+        if (addr == MAP_FAILED)
+        {
+            ::close(fd);
+            ThrowMappingError("mapping", filename);
+        }
+
+        _data = static_cast<const char*>(addr);
+    }
+
+    // the mapping keeps its own reference to the file
+    ::close(fd);
+}
+
+MappedFile::~MappedFile()
+{
+    if (_data != nullptr)
+    {
+        ::munmap(const_cast<char*>(_data), _size);
+    }
+}
+
+#endif
+
+} // namespace ashdb
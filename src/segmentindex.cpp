@@ -0,0 +1,203 @@
+#include <limits>
+#include <sstream>
+#include <utility>
+#include <stdexcept>
+
+#include "../include/ashdb/segmentindex.h"
+
+namespace ashdb
+{
+
+SegmentIndex::SegmentIndex(const std::vector<std::size_t>& entries, IndexEncoding encoding)
+    : SegmentIndex(encoding)
+{
+    if (_storage == Storage::WIDE)
+    {
+        _wide.reserve(entries.size());
+    }
+    else
+    {
+        _narrow.reserve(entries.size());
+    }
+
+    for (const auto entry : entries)
+    {
+        push_back(entry);
+    }
+}
+
+SegmentIndex SegmentIndex::Unloaded(std::size_t first, std::size_t count, IndexEncoding encoding)
+{
+    SegmentIndex index{ encoding };
+    index._first = first;
+    index._size = count;
+    index._storage = Storage::UNLOADED;
+    return index;
+}
+
+SegmentIndex SegmentIndex::Fixed(std::size_t first, std::size_t count,
+                                 std::size_t dataStart, std::size_t recordSize)
+{
+    SegmentIndex index;
+    index._first = first;
+    index._size = count;
+    index._dataStart = dataStart;
+    index._recordSize = recordSize;
+    index._storage = Storage::FIXED;
+    return index;
+}
+
+void SegmentIndex::push_back(std::size_t entry)
+{
+    if (_storage == Storage::PACKED || _storage == Storage::UNLOADED)
+    {
+        throw std::runtime_error("cannot append to a sealed segment index");
+    }
+
+    // the offsets of fixed width records are implied by their position
+    if (_storage == Storage::FIXED)
+    {
+        if (_size == 0)
+        {
+            _first = entry;
+        }
+        _size++;
+        return;
+    }
+
+    // the first entry is a record number rather than an offset, the
+    // offset of the first record in a segment is always 0
+    std::size_t offset = entry;
+    if (_size == 0)
+    {
+        _first = entry;
+        offset = 0;
+
+    }
+
+    if (_storage == Storage::NARROW
+        && offset > std::numeric_limits<std::uint32_t>::max())
+    {
+        widen();
+    }
+
+    if (_storage == Storage::NARROW)
+    {
+        _narrow.push_back(static_cast<std::uint32_t>(offset));
+    }
+    else
+    {
+        _wide.push_back(offset);
+    }
+
+    _size++;
+}
+
+std::size_t SegmentIndex::at(std::size_t i) const
+{
+    if (i >= _size)
+    {
+        std::stringstream ss;
+        ss << "segment index entry " << i << " is out of range";
+        throw std::out_of_range(ss.str());
+    }
+
+    return (*this)[i];
+}
+
+void SegmentIndex::seal()
+{
+    if (_encoding != IndexEncoding::ELIAS_FANO
+        || _storage == Storage::PACKED
+        || _storage == Storage::FIXED
+        || _storage == Storage::UNLOADED
+        || _size == 0)
+    {
+        return;
+    }
+
+    if (_storage == Storage::NARROW)
+    {
+        _packed = EliasFano(_narrow.begin(), _narrow.end());
+        _narrow = {};
+    }
+    else
+    {
+        _packed = EliasFano(_wide);
+        _wide = {};
+    }
+
+    _storage = Storage::PACKED;
+}
+
+std::size_t SegmentIndex::memoryUsage() const noexcept
+{
+    switch (_storage)
+    {
+        default:
+        case Storage::NARROW:
+            return sizeof(*this) + _narrow.capacity() * sizeof(std::uint32_t);
+        case Storage::WIDE:
+            return sizeof(*this) + _wide.capacity() * sizeof(std::uint64_t);
+        case Storage::PACKED:
+            return sizeof(*this) - sizeof(_packed) + _packed.memoryUsage();
+        case Storage::FIXED:
+        case Storage::UNLOADED:
+            return sizeof(*this);
+    }
+}
+
+void SegmentIndex::load(const std::vector<std::size_t>& entries)
+{
+    if (entries.size() != _size || (_size > 0 && entries.front() != _first))
+    {
+        std::stringstream ss;
+        ss << "index of segment starting at record " << _first << " has "
+           << entries.size() << " entries but " << _size << " were expected";
+        throw std::runtime_error(ss.str());
+    }
+
+    // only the offsets are replaced, the record number and count stay the
+    // same so that they can be read by lookups while the offsets are loaded
+    SegmentIndex loaded{ entries, _encoding };
+    loaded.seal();
+
+    _narrow = std::move(loaded._narrow);
+    _wide = std::move(loaded._wide);
+    _packed = std::move(loaded._packed);
+    _storage = loaded._storage;
+}
+
+std::vector<std::size_t> SegmentIndex::entries() const
+{
+    std::vector<std::size_t> retval;
+    retval.reserve(_size);
+    for (std::size_t i = 0; i < _size; ++i)
+    {
+        retval.push_back((*this)[i]);
+    }
+    return retval;
+}
+
+void SegmentIndex::unload()
+{
+    // there is nothing to unload, so this is always loaded
+    if (_storage == Storage::FIXED)
+    {
+        return;
+    }
+
+    _narrow = {};
+    _wide = {};
+    _packed = {};
+    _storage = Storage::UNLOADED;
+}
+
+void SegmentIndex::widen()
+{
+    _wide.assign(_narrow.begin(), _narrow.end());
+    _narrow = {};
+    _storage = Storage::WIDE;
+}
+
+} // namespace ashdb
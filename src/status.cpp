@@ -23,6 +23,8 @@ std::string ToString(OpenStatus status)
             return "INVALID_EXTENSION";
         case OpenStatus::ALREADY_OPEN:
             return "ALREADY_OPEN";
+        case OpenStatus::FORMAT_MISMATCH:
+            return "FORMAT_MISMATCH";
     }
 }
 
@@ -36,6 +38,12 @@ std::string ToString(WriteStatus status)
             return "OK";
         case WriteStatus::DATABASE_NOT_OPEN:
             return "DATABASE_NOT_OPEN";
+        case WriteStatus::QUEUE_FULL:
+            return "QUEUE_FULL";
+        case WriteStatus::DROPPED:
+            return "DROPPED";
+        case WriteStatus::INVALID_RECORD_SIZE:
+            return "INVALID_RECORD_SIZE";
     }
 }
 
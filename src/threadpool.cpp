@@ -0,0 +1,217 @@
+#include <algorithm>
+#include <exception>
+
+#include "../include/ashdb/threadpool.h"
+
+namespace ashdb
+{
+
+namespace
+{
+
+// the pool and the index of the worker running on this thread, if any
+thread_local const ThreadPool* currentPool = nullptr;
+thread_local std::size_t currentWorker = 0;
+
+} // namespace
+
+ThreadPool::ThreadPool(std::size_t threads)
+{
+    if (threads == 0)
+    {
+        threads = std::max(std::thread::hardware_concurrency(), 1u);
+    }
+
+    for (auto i = 0u; i < threads; ++i)
+    {
+        _queues.push_back(std::make_unique<TaskQueue>());
+    }
+
+    for (auto i = 0u; i < threads; ++i)
+    {
+        _threads.emplace_back([this, i]() { run(i); });
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::scoped_lock lock{ _mutex };
+        _stop = true;
+    }
+    _wake.notify_all();
+
+    for (auto& thread : _threads)
+    {
+        thread.join();
+    }
+}
+
+void ThreadPool::submit(std::function<void()> task)
+{
+    const auto queue = currentPool == this
+        ? currentWorker
+        : _nextQueue++ % _queues.size();
+
+    // the task is counted before it is queued so that a worker that takes
+    // it never sees the count drop below zero
+    {
+        std::scoped_lock lock{ _mutex };
+        _pending++;
+    }
+
+    {
+        std::scoped_lock lock{ _queues[queue]->mutex };
+        _queues[queue]->tasks.push_back(std::move(task));
+    }
+
+    _wake.notify_one();
+}
+
+bool ThreadPool::pop(std::size_t worker, std::function<void()>& task)
+{
+    {
+        auto& own = *_queues[worker];
+        std::scoped_lock lock{ own.mutex };
+        if (!own.tasks.empty())
+        {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            return true;
+        }
+    }
+
+    for (auto i = 1u; i < _queues.size(); ++i)
+    {
+        auto& other = *_queues[(worker + i) % _queues.size()];
+        std::scoped_lock lock{ other.mutex };
+        if (!other.tasks.empty())
+        {
+            task = std::move(other.tasks.front());
+            other.tasks.pop_front();
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void ThreadPool::run(std::size_t worker)
+{
+    currentPool = this;
+    currentWorker = worker;
+
+    std::function<void()> task;
+    while (true)
+    {
+        if (pop(worker, task))
+        {
+            {
+                std::scoped_lock lock{ _mutex };
+                _pending--;
+            }
+
+            task();
+            task = nullptr;
+            continue;
+        }
+
+        std::unique_lock lock{ _mutex };
+        _wake.wait(lock, [this]() { return _stop || _pending > 0; });
+        if (_stop && _pending == 0)
+        {
+            return;
+        }
+    }
+}
+
+void ThreadPool::forEach(std::size_t count, std::size_t parallelism,
+                         const std::function<void(std::size_t)>& task)
+{
+    if (count == 0)
+    {
+        return;
+    }
+
+    // shared with the helpers, which may only get to run after this
+    // call has returned if every worker is busy
+    struct State
+    {
+        std::atomic<std::size_t>    next{ 0 };
+        std::atomic_bool            failed{ false };
+
+        std::mutex                  mutex;
+        std::condition_variable     finished;
+        std::size_t                 running = 0;
+        bool                        closed = false;
+        std::exception_ptr          error;
+    };
+    const auto state = std::make_shared<State>();
+
+    // each runner keeps taking the next index until there are none left,
+    // so a runner that gets through its share quickly takes on more
+    const auto runner = [&task, count, &state = *state]()
+    {
+        for (auto i = state.next++; i < count && !state.failed; i = state.next++)
+        {
+            try
+            {
+                task(i);
+            }
+            catch (...)
+            {
+                std::scoped_lock lock{ state.mutex };
+                if (!state.error)
+                {
+                    state.error = std::current_exception();
+                }
+                state.failed = true;
+            }
+        }
+    };
+
+    if (parallelism == 0)
+    {
+        parallelism = size();
+    }
+
+    const auto helpers = std::min(parallelism, count) - 1;
+    for (auto i = 0u; i < helpers; ++i)
+    {
+        submit([state, runner]()
+        {
+            {
+                // every index was taken before this helper got to run
+                std::scoped_lock lock{ state->mutex };
+                if (state->closed)
+                {
+                    return;
+                }
+                state->running++;
+            }
+
+            runner();
+
+            std::scoped_lock lock{ state->mutex };
+            if (--state->running == 0)
+            {
+                state->finished.notify_all();
+            }
+        });
+    }
+
+    runner();
+
+    // every index has been taken, so only the helpers that already
+    // started have to finish
+    std::unique_lock lock{ state->mutex };
+    state->closed = true;
+    state->finished.wait(lock, [&state]() { return state->running == 0; });
+
+    if (state->error)
+    {
+        std::rethrow_exception(state->error);
+    }
+}
+
+} // namespace ashdb
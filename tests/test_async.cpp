@@ -0,0 +1,225 @@
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include <boost/test/unit_test.hpp>
+#include <boost/test/data/test_case.hpp>
+
+#include "Test.h"
+
+#include "../include/ashdb/ashdb.h"
+#include "../include/ashdb/primitives.h"
+
+#include "Person.h"
+
+namespace asynctest
+{
+
+// a record whose serialization waits until it is released, which lets the
+// tests hold the flusher thread in the middle of a batch so that the queue
+// fills up behind it
+struct Gated
+{
+    std::uint32_t value = 0;
+
+    static std::atomic_bool released;
+    static std::atomic_bool writing;
+};
+
+std::atomic_bool Gated::released = true;
+std::atomic_bool Gated::writing = false;
+
+void ashdb_write(std::ostream& stream, const Gated& gated)
+{
+    Gated::writing = true;
+    while (!Gated::released)
+    {
+        std::this_thread::yield();
+    }
+    ashdb::ashdb_write(stream, gated.value);
+}
+
+void ashdb_read(std::istream& stream, Gated& gated)
+{
+    ashdb::ashdb_read(stream, gated.value);
+}
+
+// queues the first record and waits until the flusher thread is blocked
+// writing it, so that every following record stays in the queue
+std::future<ashdb::WriteResult> holdFlusher(ashdb::AshDB<Gated>& db)
+{
+    Gated::released = false;
+    Gated::writing = false;
+
+    auto future = db.writeAsync(Gated{ 0 });
+    while (!Gated::writing)
+    {
+        std::this_thread::yield();
+    }
+    return future;
+}
+
+} // namespace asynctest
+
+BOOST_AUTO_TEST_SUITE(async)
+
+BOOST_AUTO_TEST_CASE(write_async)
+{
+    auto tempFolder = ashdb::test::tempFolder("write_async");
+
+    ashdb::Options options;
+    options.filesize_max = 1024;
+
+    project::PersonDB db{ tempFolder, options };
+    BOOST_TEST(db.open() == ashdb::OpenStatus::OK);
+    BOOST_TEST(db.write(project::Person::CreatePerson(0)) == ashdb::WriteStatus::OK);
+
+    std::vector<std::future<ashdb::WriteResult>> results;
+    for (auto i = 1u; i <= 200u; ++i)
+    {
+        results.push_back(db.writeAsync(project::Person::CreatePerson(i)));
+    }
+
+    for (auto i = 0u; i < results.size(); ++i)
+    {
+        const auto result = results[i].get();
+        BOOST_TEST(result.status == ashdb::WriteStatus::OK);
+        BOOST_REQUIRE(result.index.has_value());
+        BOOST_TEST(*(result.index) == i + 1);
+    }
+
+    BOOST_TEST(db.size() == 201u);
+    for (auto i = 0u; i <= 200u; ++i)
+    {
+        BOOST_TEST((db.read(i) == project::Person::CreatePerson(i)));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(write_async_close)
+{
+    auto tempFolder = ashdb::test::tempFolder("write_async_close");
+
+    std::vector<std::future<ashdb::WriteResult>> results;
+    {
+        ashdb::AshDB<std::string> db{ tempFolder };
+        BOOST_TEST(db.open() == ashdb::OpenStatus::OK);
+
+        for (auto i = 0u; i < 100u; ++i)
+        {
+            results.push_back(db.writeAsync(std::to_string(i)));
+        }
+
+        // closing writes everything that is still queued
+        db.close();
+
+        const auto closed = db.writeAsync("closed").get();
+        BOOST_TEST(closed.status == ashdb::WriteStatus::DATABASE_NOT_OPEN);
+        BOOST_TEST(!closed.index.has_value());
+    }
+
+    for (auto& result : results)
+    {
+        BOOST_TEST(result.get().status == ashdb::WriteStatus::OK);
+    }
+
+    ashdb::AshDB<std::string> db{ tempFolder };
+    BOOST_TEST(db.open() == ashdb::OpenStatus::OK);
+    BOOST_TEST(db.size() == 100u);
+    BOOST_TEST(db.read(99) == "99");
+}
+
+BOOST_AUTO_TEST_CASE(write_async_fail_fast)
+{
+    auto tempFolder = ashdb::test::tempFolder("write_async_fail_fast");
+
+    ashdb::Options options;
+    options.async_queue_size = 2;
+    options.async_backpressure = ashdb::Backpressure::FAIL_FAST;
+
+    ashdb::AshDB<asynctest::Gated> db{ tempFolder, options };
+    BOOST_TEST(db.open() == ashdb::OpenStatus::OK);
+
+    auto first = asynctest::holdFlusher(db);
+    auto second = db.writeAsync(asynctest::Gated{ 1 });
+    auto third = db.writeAsync(asynctest::Gated{ 2 });
+
+    const auto full = db.writeAsync(asynctest::Gated{ 3 }).get();
+    BOOST_TEST(full.status == ashdb::WriteStatus::QUEUE_FULL);
+    BOOST_TEST(!full.index.has_value());
+
+    asynctest::Gated::released = true;
+    BOOST_TEST(*(first.get().index) == 0u);
+    BOOST_TEST(*(second.get().index) == 1u);
+    BOOST_TEST(*(third.get().index) == 2u);
+
+    BOOST_TEST(db.size() == 3u);
+    BOOST_TEST(db.read(2).value == 2u);
+}
+
+BOOST_AUTO_TEST_CASE(write_async_drop_oldest)
+{
+    auto tempFolder = ashdb::test::tempFolder("write_async_drop_oldest");
+
+    ashdb::Options options;
+    options.async_queue_size = 2;
+    options.async_backpressure = ashdb::Backpressure::DROP_OLDEST;
+
+    ashdb::AshDB<asynctest::Gated> db{ tempFolder, options };
+    BOOST_TEST(db.open() == ashdb::OpenStatus::OK);
+
+    auto first = asynctest::holdFlusher(db);
+    auto second = db.writeAsync(asynctest::Gated{ 1 });
+    auto third = db.writeAsync(asynctest::Gated{ 2 });
+    auto fourth = db.writeAsync(asynctest::Gated{ 3 });
+
+    const auto dropped = second.get();
+    BOOST_TEST(dropped.status == ashdb::WriteStatus::DROPPED);
+    BOOST_TEST(!dropped.index.has_value());
+
+    asynctest::Gated::released = true;
+    BOOST_TEST(*(first.get().index) == 0u);
+    BOOST_TEST(*(third.get().index) == 1u);
+    BOOST_TEST(*(fourth.get().index) == 2u);
+
+    BOOST_TEST(db.size() == 3u);
+    BOOST_TEST(db.read(1).value == 2u);
+    BOOST_TEST(db.read(2).value == 3u);
+}
+
+BOOST_AUTO_TEST_CASE(write_async_block)
+{
+    auto tempFolder = ashdb::test::tempFolder("write_async_block");
+
+    ashdb::Options options;
+    options.async_queue_size = 1;
+    options.async_backpressure = ashdb::Backpressure::BLOCK;
+
+    ashdb::AshDB<asynctest::Gated> db{ tempFolder, options };
+    BOOST_TEST(db.open() == ashdb::OpenStatus::OK);
+
+    auto first = asynctest::holdFlusher(db);
+    auto second = db.writeAsync(asynctest::Gated{ 1 });
+
+    // the queue is full, so this blocks until the flusher is released
+    std::atomic_bool queued = false;
+    std::future<ashdb::WriteResult> third;
+    std::thread producer{ [&db, &queued, &third]()
+    {
+        third = db.writeAsync(asynctest::Gated{ 2 });
+        queued = true;
+    }};
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    BOOST_TEST(!queued);
+
+    asynctest::Gated::released = true;
+    producer.join();
+    BOOST_TEST(queued);
+
+    BOOST_TEST(*(first.get().index) == 0u);
+    BOOST_TEST(*(second.get().index) == 1u);
+    BOOST_TEST(*(third.get().index) == 2u);
+    BOOST_TEST(db.size() == 3u);
+}
+
+BOOST_AUTO_TEST_SUITE_END() // async
@@ -2,6 +2,10 @@
 #include <boost/test/data/test_case.hpp>
 #include <boost/algorithm/string/predicate.hpp>
 
+#include <algorithm>
+#include <fstream>
+#include <thread>
+
 #include "../include/ashdb/ashdb.h"
 #include "../include/ashdb/status.h"
 
@@ -12,6 +16,7 @@ namespace data = boost::unit_test::data;
 
 using StringDB = ashdb::AshDB<std::string>;
 
+BOOST_TEST_DONT_PRINT_LOG_VALUE(ashdb::SyncPolicy)
 
 BOOST_AUTO_TEST_SUITE(basic)
 
@@ -31,6 +36,54 @@ BOOST_AUTO_TEST_CASE(file_pattern)
 }
 #endif
 
+BOOST_AUTO_TEST_CASE(find_segment_numbers)
+{
+    auto tempFolder = ashdb::test::tempFolder("find_segment_numbers");
+
+    for (const auto name : { "data-00003.ash", "data-00001.ash", "data-00002.ash",
+                             "data-00001.ashidx", "data-0004.ash", "data-00005.bin",
+                             "other-00006.ash", "data-0000x.ash", "data-99999.ash",
+                             "data-00010.ash" })
+    {
+        std::ofstream out{ std::filesystem::path{ tempFolder } / name };
+    }
+
+    const auto segments = ashdb::FindSegmentNumbers(tempFolder, "data", "ash");
+    BOOST_TEST((segments == std::vector<std::uint16_t>{ 1, 2, 3, 10 }));
+
+    BOOST_TEST(ashdb::FindSegmentNumbers(tempFolder, "data", "dat").empty());
+}
+
+BOOST_AUTO_TEST_CASE(read_index_file)
+{
+    auto tempFolder = ashdb::test::tempFolder("read_index_file");
+    const auto filename = (std::filesystem::path{ tempFolder } / "data-00000.ashidx").string();
+
+    BOOST_TEST(ashdb::ReadIndexFile(filename).empty());
+
+    std::vector<std::size_t> entries{ 1000, 10, 20, 20, 45 };
+    {
+        std::ofstream out{ filename, std::ios::binary };
+        out.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(std::size_t));
+    }
+    BOOST_TEST(ashdb::ReadIndexFile(filename) == entries);
+
+    // a torn write leaves a partial entry at the end of the file
+    {
+        std::ofstream out{ filename, std::ios::binary | std::ios::app };
+        out.write("abc", 3);
+    }
+    BOOST_CHECK_THROW(ashdb::ReadIndexFile(filename), std::runtime_error);
+
+    // offsets must never go backwards
+    entries = { 1000, 10, 20, 15, 45 };
+    {
+        std::ofstream out{ filename, std::ios::binary | std::ios::trunc };
+        out.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(std::size_t));
+    }
+    BOOST_CHECK_THROW(ashdb::ReadIndexFile(filename), std::runtime_error);
+}
+
 BOOST_AUTO_TEST_CASE(status_to_string_tests)
 {
     ashdb::OpenStatus status;
@@ -44,6 +97,9 @@ BOOST_AUTO_TEST_CASE(status_to_string_tests)
 
     BOOST_TEST(ashdb::ToString(ashdb::WriteStatus::OK) == "OK");
     BOOST_TEST(ashdb::ToString(ashdb::WriteStatus::DATABASE_NOT_OPEN) == "DATABASE_NOT_OPEN");
+    BOOST_TEST(ashdb::ToString(ashdb::WriteStatus::QUEUE_FULL) == "QUEUE_FULL");
+    BOOST_TEST(ashdb::ToString(ashdb::WriteStatus::DROPPED) == "DROPPED");
+    BOOST_TEST(ashdb::ToString(ashdb::WriteStatus::INVALID_RECORD_SIZE) == "INVALID_RECORD_SIZE");
 }
 
 BOOST_AUTO_TEST_CASE(db_open)
@@ -458,6 +514,411 @@ BOOST_AUTO_TEST_CASE(delete_files)
     BOOST_CHECK_THROW(auto t = db->read(3), std::runtime_error);
 }
 
+BOOST_AUTO_TEST_CASE(concurrent_reads)
+{
+    auto tempFolder = ashdb::test::tempFolder("concurrent_reads");
+
+    ashdb::Options options;
+    options.filesize_max = 512;
+    options.read_cache_size = 2;
+    options.lazy_index_loading = true;
+    options.index_memory_budget = 64;
+
+    ashdb::AshDB<project::Person> db{ tempFolder, options };
+    BOOST_TEST((db.open() == ashdb::OpenStatus::OK));
+
+    for (auto i = 0u; i < 500u; ++i)
+    {
+        db.write(project::Person::CreatePerson(i));
+    }
+
+    // the readers only touch records that already exist while the main
+    // thread keeps writing new ones
+    std::atomic_bool mismatch = false;
+    std::vector<std::thread> readers;
+    for (auto t = 0u; t < 4u; ++t)
+    {
+        readers.emplace_back([&db, &mismatch, t]()
+        {
+            for (auto i = t; i < 500u; i += 3)
+            {
+                if (!(db.read(i) == project::Person::CreatePerson(i)))
+                {
+                    mismatch = true;
+                }
+            }
+
+            const auto batch = db.read(t * 100, 100);
+            for (auto i = 0u; i < batch.size(); ++i)
+            {
+                if (!(batch[i] == project::Person::CreatePerson(t * 100 + i)))
+                {
+                    mismatch = true;
+                }
+            }
+        });
+    }
+
+    for (auto i = 500u; i < 1000u; ++i)
+    {
+        db.write(project::Person::CreatePerson(i));
+    }
+
+    for (auto& reader : readers)
+    {
+        reader.join();
+    }
+
+    BOOST_TEST(!mismatch);
+    BOOST_TEST(db.size() == 1000u);
+    BOOST_TEST((db.read(999) == project::Person::CreatePerson(999)));
+}
+
+BOOST_AUTO_TEST_CASE(concurrent_writes_close)
+{
+    auto tempFolder = ashdb::test::tempFolder("concurrent_writes_close");
+
+    ashdb::Options options;
+    options.filesize_max = 256;
+
+    constexpr auto ThreadCount = 8u;
+
+    // every write either makes it into the database or is told that it
+    // didn't, however it lines up with the database being closed
+    std::atomic_size_t written = 0;
+    {
+        ashdb::AshDB<std::string> db{ tempFolder, options };
+        BOOST_TEST((db.open() == ashdb::OpenStatus::OK));
+
+        std::atomic_bool mismatch = false;
+        std::vector<std::thread> writers;
+        for (auto t = 0u; t < ThreadCount; ++t)
+        {
+            writers.emplace_back([&db, &written, &mismatch]()
+            {
+                for (auto i = 0u; i < 500u; ++i)
+                {
+                    const auto status = db.write(std::to_string(i));
+                    if (status == ashdb::WriteStatus::OK)
+                    {
+                        written++;
+                    }
+                    else if (status != ashdb::WriteStatus::DATABASE_NOT_OPEN)
+                    {
+                        mismatch = true;
+                    }
+                }
+            });
+        }
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        db.close();
+
+        for (auto& writer : writers)
+        {
+            writer.join();
+        }
+        BOOST_TEST(!mismatch);
+    }
+
+    ashdb::AshDB<std::string> db{ tempFolder, options };
+    BOOST_TEST((db.open() == ashdb::OpenStatus::OK));
+    BOOST_TEST(db.size() == written);
+}
+
+BOOST_AUTO_TEST_CASE(concurrent_boundaries)
+{
+    auto tempFolder = ashdb::test::tempFolder("concurrent_boundaries");
+
+    ashdb::Options options;
+    options.filesize_max = 512;
+    options.database_max = 4096;
+
+    ashdb::AshDB<int> db{ tempFolder, options };
+    BOOST_TEST((db.open() == ashdb::OpenStatus::OK));
+    BOOST_TEST(db.write(0) == ashdb::WriteStatus::OK);
+
+    // the boundaries only ever move forwards while records are written and
+    // the oldest segments expire
+    std::atomic_bool done = false;
+    std::atomic_bool mismatch = false;
+    std::vector<std::thread> readers;
+    for (auto t = 0u; t < 4u; ++t)
+    {
+        readers.emplace_back([&db, &done, &mismatch]()
+        {
+            std::size_t start = 0;
+            std::size_t last = 0;
+            while (!done)
+            {
+                const auto nextStart = db.startIndex();
+                const auto nextLast = db.lastIndex();
+                if (!nextStart || !nextLast || *nextStart < start || *nextLast < last
+                    || db.size() == 0 || !db.opened())
+                {
+                    mismatch = true;
+                }
+                start = nextStart.value_or(start);
+                last = nextLast.value_or(last);
+            }
+        });
+    }
+
+    for (auto i = 1; i < 3000; ++i)
+    {
+        db.write(i);
+    }
+    done = true;
+
+    for (auto& reader : readers)
+    {
+        reader.join();
+    }
+
+    BOOST_TEST(!mismatch);
+    BOOST_TEST(*db.startIndex() > 0u);
+    BOOST_TEST(*db.lastIndex() == 2999u);
+}
+
+BOOST_AUTO_TEST_CASE(concurrent_writes)
+{
+    auto tempFolder = ashdb::test::tempFolder("concurrent_writes");
+
+    ashdb::Options options;
+    options.filesize_max = 256;
+
+    constexpr auto ThreadCount = 8u;
+    constexpr auto RecordsPerThread = 200u;
+
+    {
+        ashdb::AshDB<std::string> db{ tempFolder, options };
+        BOOST_TEST((db.open() == ashdb::OpenStatus::OK));
+
+        std::vector<std::thread> writers;
+        for (auto t = 0u; t < ThreadCount; ++t)
+        {
+            writers.emplace_back([&db, t]()
+            {
+                for (auto i = 0u; i < RecordsPerThread; ++i)
+                {
+                    db.write(std::to_string(t) + ":" + std::to_string(i));
+                }
+            });
+        }
+
+        for (auto& writer : writers)
+        {
+            writer.join();
+        }
+
+        BOOST_TEST(db.size() == ThreadCount * RecordsPerThread);
+    }
+
+    // every record must have been written exactly once, and the records
+    // of each writer must be in the order that writer wrote them
+    ashdb::AshDB<std::string> db{ tempFolder, options };
+    BOOST_TEST((db.open() == ashdb::OpenStatus::OK));
+    BOOST_TEST(db.size() == ThreadCount * RecordsPerThread);
+
+    std::vector<std::size_t> nextRecord(ThreadCount, 0);
+    for (const auto& record : db.read(0, db.size()))
+    {
+        const auto separator = record.find(':');
+        const auto t = std::stoul(record.substr(0, separator));
+        BOOST_TEST(std::stoul(record.substr(separator + 1)) == nextRecord.at(t));
+        nextRecord.at(t)++;
+    }
+
+    BOOST_TEST((nextRecord == std::vector<std::size_t>(ThreadCount, RecordsPerThread)));
+}
+
+BOOST_DATA_TEST_CASE(sync_policies,
+    data::make({ ashdb::SyncPolicy::NONE,
+                 ashdb::SyncPolicy::PER_RECORD,
+                 ashdb::SyncPolicy::PER_BATCH,
+                 ashdb::SyncPolicy::INTERVAL }),
+    policy)
+{
+    auto tempFolder = ashdb::test::tempFolder("sync_policies");
+
+    ashdb::Options options;
+    options.filesize_max = 512;
+    options.sync_policy = policy;
+    options.sync_interval = std::chrono::milliseconds(1);
+    options.sync_bytes = 256;
+
+    {
+        project::PersonDB db{ tempFolder, options };
+        BOOST_TEST(db.open() == ashdb::OpenStatus::OK);
+
+        for (auto i = 0u; i < 50u; ++i)
+        {
+            BOOST_TEST(db.write(project::Person::CreatePerson(i)) == ashdb::WriteStatus::OK);
+        }
+
+        project::PersonDB::Batch batch;
+        for (auto i = 50u; i < 100u; ++i)
+        {
+            batch.push_back(project::Person::CreatePerson(i));
+        }
+        BOOST_TEST(db.write(batch) == ashdb::WriteStatus::OK);
+        BOOST_TEST(db.writeAsync(project::Person::CreatePerson(100)).get().status == ashdb::WriteStatus::OK);
+
+        // the sync thread must be stopped and restarted with the database
+        db.close();
+        BOOST_TEST(db.open() == ashdb::OpenStatus::OK);
+        BOOST_TEST(db.write(project::Person::CreatePerson(101)) == ashdb::WriteStatus::OK);
+    }
+
+    project::PersonDB db{ tempFolder, options };
+    BOOST_TEST(db.open() == ashdb::OpenStatus::OK);
+    BOOST_TEST(db.size() == 102u);
+    for (auto i = 0u; i < 102u; ++i)
+    {
+        BOOST_TEST((db.read(i) == project::Person::CreatePerson(i)));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(interval_sync_after_move)
+{
+    auto tempFolder = ashdb::test::tempFolder("interval_sync_after_move");
+
+    ashdb::Options options;
+    options.sync_policy = ashdb::SyncPolicy::INTERVAL;
+    options.sync_interval = std::chrono::milliseconds(1);
+    options.write_buffer_size = 64 * 1024;
+
+    project::PersonDB db{ tempFolder, options };
+    BOOST_TEST(db.open() == ashdb::OpenStatus::OK);
+
+    project::PersonDB moved{ std::move(db) };
+    for (auto i = 0u; i < 10u; ++i)
+    {
+        BOOST_TEST(moved.write(project::Person::CreatePerson(i)) == ashdb::WriteStatus::OK);
+    }
+
+    // the buffered records only reach the data file when the moved database
+    // has a sync thread of its own
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (std::filesystem::file_size(moved.activeDataFile()) == 0
+        && std::chrono::steady_clock::now() < deadline)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    BOOST_TEST(std::filesystem::file_size(moved.activeDataFile()) > 0u);
+}
+
+BOOST_AUTO_TEST_CASE(write_buffer)
+{
+    auto tempFolder = ashdb::test::tempFolder("write_buffer");
+
+    ashdb::Options options;
+    options.filesize_max = 4096;
+    options.write_buffer_size = 1024;
+
+    {
+        project::PersonDB db{ tempFolder, options };
+        BOOST_TEST(db.open() == ashdb::OpenStatus::OK);
+
+        // every record is readable as soon as it is written, whether it is
+        // still buffered or not
+        for (auto i = 0u; i < 200u; ++i)
+        {
+            BOOST_TEST(db.write(project::Person::CreatePerson(i)) == ashdb::WriteStatus::OK);
+            BOOST_TEST((db.read(i) == project::Person::CreatePerson(i)));
+        }
+
+        // the newest records haven't been written to the active segment yet
+        const auto records = db.read(150, 50);
+        BOOST_TEST(records.size() == 50u);
+        BOOST_TEST((records.back() == project::Person::CreatePerson(199)));
+        BOOST_TEST(std::filesystem::file_size(db.activeDataFile()) < 4096u);
+
+        // truncating writes the buffered records that are kept
+        db.truncate(195);
+        BOOST_TEST(db.size() == 195u);
+        BOOST_TEST((db.read(194) == project::Person::CreatePerson(194)));
+
+        BOOST_TEST(db.write(project::Person::CreatePerson(195)) == ashdb::WriteStatus::OK);
+    }
+
+    // buffered records are written when the database is destroyed
+    project::PersonDB db{ tempFolder, options };
+    BOOST_TEST(db.open() == ashdb::OpenStatus::OK);
+    BOOST_TEST(db.size() == 196u);
+    for (auto i = 0u; i < 196u; ++i)
+    {
+        BOOST_TEST((db.read(i) == project::Person::CreatePerson(i)));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(read_after_retention)
+{
+    auto tempFolder = (ashdb::test::tempFolder("read_after_retention"));
+
+    ashdb::Options options;
+    options.filesize_max = 100;
+    options.database_max = 300;
+    options.read_cache_size = 2;
+
+    auto db = std::make_unique<StringDB>(tempFolder, options);
+    BOOST_TEST(db->open() == ashdb::OpenStatus::OK);
+
+    for (auto x = 0u; x < 10; ++x)
+    {
+        const std::string str(110, std::to_string(x).at(0));
+        BOOST_TEST(db->write(str) == ashdb::WriteStatus::OK);
+
+        // read every available record so that the segments being
+        // deleted by retention are in the read cache
+        for (auto i = *(db->startIndex()); i <= *(db->lastIndex()); ++i)
+        {
+            BOOST_TEST(db->read(i) == std::string(110, std::to_string(i).at(0)));
+        }
+    }
+
+    BOOST_TEST(db->startSegmentNumber() > 0);
+
+    const auto start = *(db->startIndex());
+    const auto batch = db->read(start, db->size());
+    BOOST_TEST(batch.size() == db->size());
+    for (auto i = 0u; i < batch.size(); ++i)
+    {
+        BOOST_TEST(batch[i] == std::string(110, std::to_string(start + i).at(0)));
+    }
+
+    BOOST_CHECK_THROW(db->read(start, db->size() + 1), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(segment_gap)
+{
+    auto tempFolder = ashdb::test::tempFolder("segment_gap");
+
+    ashdb::Options options;
+    options.filesize_max = 100;
+
+    auto db = std::make_unique<StringDB>(tempFolder, options);
+    BOOST_TEST(db->open() == ashdb::OpenStatus::OK);
+
+    for (auto x = 0u; x < 6; ++x)
+    {
+        BOOST_TEST(db->write(std::string(110, 'A' + x)) == ashdb::WriteStatus::OK);
+    }
+    db->close();
+
+    // with segment 2 missing only the newest contiguous segments are used
+    std::filesystem::remove(ashdb::BuildFilename(tempFolder, "data", "ash", 2));
+    std::filesystem::remove(ashdb::BuildFilename(tempFolder, "data", "ashidx", 2));
+
+    BOOST_TEST(db->open() == ashdb::OpenStatus::OK);
+    BOOST_TEST(db->startSegmentNumber() == 3);
+    BOOST_TEST(db->activeSegmentNumber() == 6);
+    BOOST_TEST(*db->startIndex() == 3);
+    BOOST_TEST(*db->lastIndex() == 5);
+    BOOST_TEST(db->read(3) == std::string(110, 'D'));
+    BOOST_TEST(db->read(5) == std::string(110, 'F'));
+}
+
 BOOST_AUTO_TEST_CASE(move_ctor)
 {
     auto tempFolder = ashdb::test::tempFolder("move_ctor");
@@ -508,6 +969,40 @@ BOOST_AUTO_TEST_CASE(db_size)
     BOOST_TEST(db.databaseSize() > 210);
 }
 
+BOOST_AUTO_TEST_CASE(append_after_reopen)
+{
+    auto tempFolder = ashdb::test::tempFolder("append_after_reopen");
+
+    ashdb::Options options;
+    options.filesize_max = 256;
+
+    auto db = std::make_unique<StringDB>(tempFolder, options);
+    BOOST_TEST(db->open() == ashdb::OpenStatus::OK);
+
+    for (auto i = 0u; i < 10; ++i)
+    {
+        BOOST_TEST(db->write(std::to_string(i) + e100Chars) == ashdb::WriteStatus::OK);
+    }
+
+    // the active segment is held open by the database, so make sure that
+    // closing and reopening picks up where the previous writes left off
+    db->close();
+    BOOST_TEST(db->open() == ashdb::OpenStatus::OK);
+
+    for (auto i = 10u; i < 20; ++i)
+    {
+        BOOST_TEST(db->write(std::to_string(i) + e100Chars) == ashdb::WriteStatus::OK);
+    }
+
+    BOOST_TEST(db->size() == 20);
+    BOOST_TEST(std::filesystem::file_size(db->activeIndexFile()) == ashdb::INDEX_HEADER_SIZE + (2 * sizeof(std::size_t)));
+
+    for (auto i = 0u; i < 20; ++i)
+    {
+        BOOST_TEST(db->read(i) == std::to_string(i) + e100Chars);
+    }
+}
+
 BOOST_AUTO_TEST_CASE(iterator1)
 {
     auto tempFolder = ashdb::test::tempFolder("iterator1");
@@ -560,4 +1055,158 @@ BOOST_AUTO_TEST_CASE(iterator2)
     }
 }
 
+BOOST_DATA_TEST_CASE(iterator_random_access,
+    data::make({ 1u, 7u, 1024u }) * data::make({ false, true }),
+    window, prefetch)
+{
+    auto tempFolder = ashdb::test::tempFolder("iterator_random_access");
+
+    ashdb::Options options;
+    options.filesize_max = 1024;
+    options.read_ahead_window = window;
+    options.read_ahead_prefetch = prefetch;
+
+    ashdb::AshDB<int> db{tempFolder, options};
+    BOOST_TEST(db.open() == ashdb::OpenStatus::OK);
+
+    ashdb::AshDB<int>::Batch batch;
+    for (auto i = 0; i < 2000; ++i)
+    {
+        batch.push_back(i * 10);
+    }
+    BOOST_TEST(db.write(batch) == ashdb::WriteStatus::OK);
+
+    BOOST_TEST(std::distance(db.begin(), db.end()) == 2000);
+    BOOST_TEST(std::equal(db.begin(), db.end(), batch.begin(), batch.end()));
+
+    // a binary search on the sorted records
+    const auto found = std::lower_bound(db.begin(), db.end(), 12345);
+    BOOST_TEST((found - db.begin()) == 1235);
+    BOOST_TEST(*found == 12350);
+    BOOST_TEST(std::binary_search(db.begin(), db.end(), 19990));
+    BOOST_TEST(!std::binary_search(db.begin(), db.end(), 19991));
+
+    // backwards, and with offsets from an iterator
+    auto it = db.end();
+    for (auto i = 1999; i >= 0; --i)
+    {
+        --it;
+        BOOST_TEST(*it == i * 10);
+    }
+    BOOST_TEST((it == db.begin()));
+    BOOST_TEST(it[1500] == 15000);
+    BOOST_TEST(*(db.end() - 1) == 19990);
+
+    // dereferencing twice gives the same record, and a copy keeps its own
+    // window when the original moves on
+    auto first = db.begin() + 10;
+    const auto copy = first;
+    BOOST_TEST(*first == *copy);
+    first += 1500;
+    BOOST_TEST(*first == 15100);
+    BOOST_TEST(*copy == 100);
+}
+
+BOOST_AUTO_TEST_CASE(iterator_retention)
+{
+    auto tempFolder = ashdb::test::tempFolder("iterator_retention");
+
+    ashdb::Options options;
+    options.filesize_max = 1024;
+    options.database_max = 4096;
+
+    ashdb::AshDB<int> db{tempFolder, options};
+    BOOST_TEST(db.open() == ashdb::OpenStatus::OK);
+    for (auto i = 0; i < 2000; ++i)
+    {
+        BOOST_TEST(db.write(i) == ashdb::WriteStatus::OK);
+    }
+    BOOST_REQUIRE(*db.startIndex() > 0u);
+
+    // iteration starts at the oldest record that was kept
+    auto expected = static_cast<int>(*db.startIndex());
+    for (const auto value : db)
+    {
+        BOOST_TEST(value == expected++);
+    }
+    BOOST_TEST(expected == 2000);
+}
+
+BOOST_AUTO_TEST_CASE(retention_empty_segment)
+{
+    auto tempFolder = ashdb::test::tempFolder("retention_empty_segment");
+
+    ashdb::Options options;
+    options.filesize_max = 1024;
+    options.database_max = 4096;
+
+    std::uint16_t startSegment = 0;
+    std::uintmax_t size = 0;
+    {
+        ashdb::AshDB<int> db{ tempFolder, options };
+        BOOST_TEST(db.open() == ashdb::OpenStatus::OK);
+        for (auto i = 0; i < 2000; ++i)
+        {
+            BOOST_TEST(db.write(i) == ashdb::WriteStatus::OK);
+        }
+        startSegment = db.startSegmentNumber();
+        size = db.databaseSize();
+    }
+    BOOST_REQUIRE(startSegment > 0u);
+
+    // a sealed segment ahead of the others whose records never made it to
+    // its index file
+    {
+        const auto segment = static_cast<std::uint16_t>(startSegment - 1);
+        std::ofstream data{ ashdb::BuildFilename(tempFolder, options.prefix, options.extension, segment),
+                            std::ios::binary };
+        data.write(piStr, 100);
+        std::ofstream index{ ashdb::BuildFilename(tempFolder, options.prefix,
+                                                  options.extension + ashdb::INDEX_EXTENSION, segment),
+                             std::ios::binary };
+    }
+
+    ashdb::AshDB<int> db{ tempFolder, options };
+    BOOST_TEST(db.open() == ashdb::OpenStatus::OK);
+    BOOST_TEST(db.startSegmentNumber() == startSegment);
+    BOOST_TEST(db.databaseSize() == size);
+
+    for (auto i = 2000; i < 4000; ++i)
+    {
+        BOOST_TEST(db.write(i) == ashdb::WriteStatus::OK);
+    }
+    BOOST_TEST(db.startSegmentNumber() > startSegment);
+    BOOST_TEST(db.databaseSize() <= options.database_max);
+
+    auto expected = static_cast<int>(*db.startIndex());
+    for (const auto value : db.read(*db.startIndex(), db.size()))
+    {
+        BOOST_REQUIRE(value == expected++);
+    }
+    BOOST_TEST(expected == 4000);
+
+    // the running size must match the size of the files that are left,
+    // and closing waits for the reaper so the empty segment is gone too
+    size = db.databaseSize();
+    db.close();
+    BOOST_TEST(!std::filesystem::exists(ashdb::BuildFilename(tempFolder, options.prefix, options.extension,
+                                                            static_cast<std::uint16_t>(startSegment - 1))));
+
+    std::uintmax_t onDisk = 0;
+    for (const auto& entry : std::filesystem::directory_iterator{ tempFolder })
+    {
+        if (entry.path().extension() != "." + options.extension)
+        {
+            continue;
+        }
+
+        const auto footer = ashdb::ReadSegmentFooter(ashdb::File{ entry.path().string(), ashdb::File::Mode::Read });
+        onDisk += footer ? footer->dataSize : std::filesystem::file_size(entry.path());
+    }
+    BOOST_TEST(onDisk == size);
+
+    BOOST_TEST(db.open() == ashdb::OpenStatus::OK);
+    BOOST_TEST(db.databaseSize() == size);
+}
+
 BOOST_AUTO_TEST_SUITE_END() 
\ No newline at end of file
@@ -14,6 +14,95 @@ namespace data = boost::unit_test::data;
 
 using StringDB = ashdb::AshDB<std::string>;
 
+namespace rawtest
+{
+
+// an int that is serialized field by field instead of as a raw record,
+// which must give exactly the same files as a database of ints
+struct WrappedInt
+{
+    int value = 0;
+};
+
+void ashdb_write(std::ostream& stream, const WrappedInt& wrapped)
+{
+    ashdb::ashdb_write(stream, wrapped.value);
+}
+
+void ashdb_read(std::istream& stream, WrappedInt& wrapped)
+{
+    ashdb::ashdb_read(stream, wrapped.value);
+}
+
+// a struct with padding that opts in to being stored as a raw record
+struct Sample
+{
+    std::uint8_t    channel = 0;
+    std::uint32_t   value = 0;
+    double          time = 0;
+
+    bool operator==(const Sample& other) const
+    {
+        return channel == other.channel && value == other.value && time == other.time;
+    }
+
+    static Sample Create(std::uint32_t i)
+    {
+        return Sample{ static_cast<std::uint8_t>(i % 7), i * 3, i / 4.0 };
+    }
+};
+
+} // namespace rawtest
+
+template<>
+struct ashdb::RawRecord<rawtest::Sample> : std::true_type {};
+
+namespace buffertest
+{
+
+// a record whose overloads are templated on the stream, so that it is
+// serialized into a `BufferWriter` rather than through `std::ostream`
+struct Reading
+{
+    std::string     sensor;
+    std::uint32_t   id = 0;
+    double          value = 0;
+
+    bool operator==(const Reading& other) const
+    {
+        return sensor == other.sensor && id == other.id && value == other.value;
+    }
+
+    static Reading Create(std::uint32_t i)
+    {
+        return Reading{ "sensor" + std::to_string(i % 13), i, i * 0.25 };
+    }
+};
+
+template<typename StreamT>
+void ashdb_write(StreamT& stream, const Reading& reading)
+{
+    ashdb::ashdb_write(stream, reading.sensor);
+    ashdb::ashdb_write(stream, reading.id);
+    ashdb::ashdb_write(stream, reading.value);
+}
+
+template<typename StreamT>
+void ashdb_read(StreamT& stream, Reading& reading)
+{
+    ashdb::ashdb_read(stream, reading.sensor);
+    ashdb::ashdb_read(stream, reading.id);
+    ashdb::ashdb_read(stream, reading.value);
+}
+
+} // namespace buffertest
+
+static std::string ReadFile(const std::string& filename)
+{
+    std::ifstream file{ filename, std::ios::binary };
+    return std::string{ std::istreambuf_iterator<char>{ file }, std::istreambuf_iterator<char>{} };
+}
+
 BOOST_AUTO_TEST_SUITE(batch)
 
 BOOST_AUTO_TEST_CASE(batch_not_open)
@@ -233,6 +322,114 @@ BOOST_AUTO_TEST_CASE(batch_read_write_multiple_files)
     }
 }
 
+BOOST_DATA_TEST_CASE(batch_read_ranges,
+    data::make({ false, true }) * data::make({ 0u, 1024u }),
+    mmap, bufferSize)
+{
+    auto tempFolder = ashdb::test::tempFolder("batch_read_ranges");
+
+    ashdb::Options options;
+    options.filesize_max = 4096;
+    options.mmap_sealed_segments = mmap;
+    options.write_buffer_size = bufferSize;
+
+    project::PersonDB db{ tempFolder, options };
+    BOOST_TEST(db.open() == ashdb::OpenStatus::OK);
+    for (auto i = 0u; i < 500u; ++i)
+    {
+        BOOST_TEST(db.write(project::Person::CreatePerson(i)) == ashdb::WriteStatus::OK);
+    }
+    BOOST_TEST(db.segmentIndices().size() > 3u);
+
+    // ranges within a segment, across several segments and into the
+    // newest records, which may still be buffered
+    for (const auto& [index, count] : { std::pair{ 0u, 500u }, { 3u, 5u }, { 90u, 200u }, { 480u, 20u }, { 499u, 1u } })
+    {
+        const auto records = db.read(index, count);
+        BOOST_REQUIRE(records.size() == count);
+        for (auto i = 0u; i < count; ++i)
+        {
+            BOOST_TEST((records[i] == project::Person::CreatePerson(index + i)));
+        }
+    }
+}
+
+BOOST_DATA_TEST_CASE(scan_records,
+    data::make({ false, true }) * data::make({ 0u, 1024u }),
+    mmap, bufferSize)
+{
+    auto tempFolder = ashdb::test::tempFolder("scan_records");
+
+    ashdb::Options options;
+    options.filesize_max = 4096;
+    options.mmap_sealed_segments = mmap;
+    options.write_buffer_size = bufferSize;
+
+    project::PersonDB db{ tempFolder, options };
+    BOOST_TEST(db.open() == ashdb::OpenStatus::OK);
+    for (auto i = 0u; i < 500u; ++i)
+    {
+        BOOST_TEST(db.write(project::Person::CreatePerson(i)) == ashdb::WriteStatus::OK);
+    }
+
+    // every record is visited in order, and only the ones that are kept
+    // are decoded
+    std::size_t next = 10;
+    std::vector<project::Person> married;
+    db.scan(10, 490, [&next, &married](std::size_t index, std::string_view bytes)
+    {
+        BOOST_TEST(index == next++);
+        BOOST_TEST(!bytes.empty());
+        if (index % 2 == 0)
+        {
+            married.push_back(project::PersonDB::decode(bytes));
+        }
+    });
+    BOOST_TEST(next == 490u);
+    BOOST_REQUIRE(married.size() == 240u);
+    for (auto i = 0u; i < married.size(); ++i)
+    {
+        BOOST_TEST((married[i] == project::Person::CreatePerson(10 + (i * 2))));
+    }
+
+    // returning false stops the scan
+    std::size_t visited = 0;
+    db.scan(0, db.size(), [&visited](std::size_t index, std::string_view)
+    {
+        visited++;
+        return index < 99;
+    });
+    BOOST_TEST(visited == 100u);
+
+    BOOST_CHECK_THROW(db.scan(0, 501, [](std::size_t, std::string_view) {}), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(scan_raw_records)
+{
+    auto tempFolder = ashdb::test::tempFolder("scan_raw_records");
+
+    ashdb::Options options;
+    options.filesize_max = 1024;
+
+    ashdb::AshDB<std::uint32_t> db{ tempFolder, options };
+    BOOST_TEST(db.open() == ashdb::OpenStatus::OK);
+
+    ashdb::AshDB<std::uint32_t>::Batch batch;
+    for (auto i = 0u; i < 1000u; ++i)
+    {
+        batch.push_back(i * 3);
+    }
+    BOOST_TEST(db.write(batch) == ashdb::WriteStatus::OK);
+
+    std::uint64_t sum = 0;
+    db.scan(0, db.size(), [&sum](std::size_t, std::string_view bytes)
+    {
+        BOOST_TEST(bytes.size() == sizeof(std::uint32_t));
+        sum += ashdb::AshDB<std::uint32_t>::decode(bytes);
+    });
+    BOOST_TEST(sum == 3u * (999u * 1000u / 2));
+}
+
 BOOST_AUTO_TEST_CASE(batch_trim)
 {
     auto tempFolder = (ashdb::test::tempFolder("batch_trim"));
@@ -257,6 +454,58 @@ BOOST_AUTO_TEST_CASE(batch_trim)
     BOOST_CHECK_THROW(batch = db->read(0,10), std::runtime_error);
 }
 
+BOOST_AUTO_TEST_CASE(batch_trim_segments)
+{
+    auto tempFolder = (ashdb::test::tempFolder("batch_trim_segments"));
+
+    ashdb::Options options;
+    options.filesize_max = 1024;
+    options.database_max = 4096;
+
+    auto db = std::make_unique<project::PersonDB>(tempFolder, options);
+    BOOST_TEST(db->open() == ashdb::OpenStatus::OK);
+    BOOST_TEST(db->write(project::Person::CreatePerson(0)) == ashdb::WriteStatus::OK);
+
+    // a single batch that is several times the size of the database
+    project::PersonDB::Batch batch;
+    for (auto i = 1u; i < 1000; ++i)
+    {
+        batch.push_back(project::Person::CreatePerson(i));
+    }
+    BOOST_TEST(db->write(batch) == ashdb::WriteStatus::OK);
+
+    BOOST_TEST(db->databaseSize() <= options.database_max);
+    BOOST_TEST(db->lastIndex().value() == 999u);
+    BOOST_TEST(db->startIndex().value() > 900u);
+    BOOST_TEST(db->segmentIndices().size() < 6u);
+
+    const auto first = db->startIndex().value();
+    const auto records = db->read(first, db->size());
+    for (auto i = 0u; i < records.size(); ++i)
+    {
+        BOOST_REQUIRE((records[i] == project::Person::CreatePerson(first + i)));
+    }
+
+    // the files of the dropped segments are gone once the database is closed
+    // and the size is the same as the files that are left
+    const auto start = db->startSegmentNumber();
+    db->close();
+    std::uint64_t size = 0;
+    for (const auto& entry : std::filesystem::directory_iterator(tempFolder))
+    {
+        if (entry.path().extension() == ".ash")
+        {
+            size += entry.file_size();
+        }
+    }
+    BOOST_TEST(!std::filesystem::exists(
+        ashdb::BuildFilename(tempFolder, options.prefix, options.extension, start - 1)));
+
+    BOOST_TEST(db->open() == ashdb::OpenStatus::OK);
+    BOOST_TEST(db->startIndex().value() == first);
+    BOOST_TEST(db->databaseSize() <= size);
+}
+
 BOOST_AUTO_TEST_CASE(batch_errors)
 {
     auto tempFolder = (ashdb::test::tempFolder("batch_errors"));
@@ -278,4 +527,187 @@ BOOST_AUTO_TEST_CASE(empty_batch_write)
     BOOST_TEST(db->write(StringDB::Batch{}) == ashdb::WriteStatus::OK);
 }
 
+BOOST_AUTO_TEST_CASE(raw_records_same_files)
+{
+    ashdb::Options options;
+    options.filesize_max = 100;
+
+    auto rawFolder = ashdb::test::tempFolder("raw_records_same_files_raw");
+    auto wrappedFolder = ashdb::test::tempFolder("raw_records_same_files_wrapped");
+
+    ashdb::AshDB<int> rawdb{ rawFolder, options };
+    ashdb::AshDB<rawtest::WrappedInt> wrappeddb{ wrappedFolder, options };
+    BOOST_TEST(rawdb.open() == ashdb::OpenStatus::OK);
+    BOOST_TEST(wrappeddb.open() == ashdb::OpenStatus::OK);
+
+    // a mix of single writes and batches that cross segment boundaries
+    int next = 0;
+    for (auto size : { 1u, 3u, 40u, 1u, 1u, 130u, 7u })
+    {
+        ashdb::AshDB<int>::Batch batch;
+        ashdb::AshDB<rawtest::WrappedInt>::Batch wrapped;
+        for (auto i = 0u; i < size; ++i, ++next)
+        {
+            batch.push_back(next);
+            wrapped.push_back(rawtest::WrappedInt{ next });
+        }
+
+        if (size == 1)
+        {
+            BOOST_TEST(rawdb.write(batch.front()) == ashdb::WriteStatus::OK);
+            BOOST_TEST(wrappeddb.write(wrapped.front()) == ashdb::WriteStatus::OK);
+        }
+        else
+        {
+            BOOST_TEST(rawdb.write(batch) == ashdb::WriteStatus::OK);
+            BOOST_TEST(wrappeddb.write(wrapped) == ashdb::WriteStatus::OK);
+        }
+    }
+
+    BOOST_TEST(rawdb.size() == wrappeddb.size());
+    BOOST_TEST(rawdb.startSegmentNumber() == wrappeddb.startSegmentNumber());
+    BOOST_TEST(rawdb.activeSegmentNumber() == wrappeddb.activeSegmentNumber());
+    for (auto i = rawdb.startSegmentNumber(); i <= rawdb.activeSegmentNumber(); ++i)
+    {
+        // only the active segment has an index file, the offsets of every
+        // other segment are in the footer of its data file
+        for (const auto& extension : { options.extension, options.extension + "idx" })
+        {
+            if (extension != options.extension && i < rawdb.activeSegmentNumber())
+            {
+                BOOST_TEST(!std::filesystem::exists(ashdb::BuildFilename(rawFolder, options.prefix, extension, i)));
+                continue;
+            }
+
+            const auto raw = ReadFile(ashdb::BuildFilename(rawFolder, options.prefix, extension, i));
+            const auto wrapped = ReadFile(ashdb::BuildFilename(wrappedFolder, options.prefix, extension, i));
+            BOOST_TEST(!raw.empty());
+            BOOST_TEST(raw == wrapped);
+        }
+    }
+
+    const auto records = rawdb.read(0, rawdb.size());
+    BOOST_TEST(records.size() == static_cast<std::size_t>(next));
+    for (auto i = 0; i < next; ++i)
+    {
+        BOOST_TEST(records[i] == i);
+        BOOST_TEST(rawdb.read(i) == i);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(raw_records_struct)
+{
+    auto tempFolder = ashdb::test::tempFolder("raw_records_struct");
+
+    ashdb::Options options;
+    options.filesize_max = 1000;
+    options.write_buffer_size = 256;
+
+    ashdb::AshDB<rawtest::Sample>::Batch batch;
+    for (auto i = 0u; i < 500u; ++i)
+    {
+        batch.push_back(rawtest::Sample::Create(i));
+    }
+
+    {
+        ashdb::AshDB<rawtest::Sample> db{ tempFolder, options };
+        BOOST_TEST(db.open() == ashdb::OpenStatus::OK);
+        BOOST_TEST(db.write(batch) == ashdb::WriteStatus::OK);
+        for (auto i = 500u; i < 510u; ++i)
+        {
+            BOOST_TEST(db.write(rawtest::Sample::Create(i)) == ashdb::WriteStatus::OK);
+        }
+
+        // the last records are still buffered, so this range is read
+        // partly from the files and partly from memory
+        const auto records = db.read(480, 30);
+        for (auto i = 0u; i < records.size(); ++i)
+        {
+            BOOST_TEST((records[i] == rawtest::Sample::Create(480 + i)));
+        }
+        BOOST_TEST((db.read(509) == rawtest::Sample::Create(509)));
+    }
+
+    ashdb::AshDB<rawtest::Sample> db{ tempFolder, options };
+    BOOST_TEST(db.open() == ashdb::OpenStatus::OK);
+    BOOST_TEST(db.size() == 510u);
+    BOOST_TEST(db.activeSegmentNumber() > 0);
+
+    const auto records = db.read(0, 510);
+    for (auto i = 0u; i < records.size(); ++i)
+    {
+        BOOST_TEST((records[i] == rawtest::Sample::Create(i)));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(buffer_serialization)
+{
+    static_assert(ashdb::IsBufferSerializable<int>);
+    static_assert(ashdb::IsBufferSerializable<std::string>);
+    static_assert(ashdb::IsBufferSerializable<buffertest::Reading>);
+    static_assert(!ashdb::IsBufferSerializable<project::Person>);
+    static_assert(!ashdb::IsBufferSerializable<rawtest::WrappedInt>);
+
+    // both ways of serializing a record must give exactly the same bytes
+    for (auto i = 0u; i < 10u; ++i)
+    {
+        const auto reading = buffertest::Reading::Create(i);
+
+        ashdb::RecordBuffer stream;
+        ashdb_write(stream, reading);
+
+        ashdb::BufferWriter writer;
+        ashdb_write(writer, reading);
+
+        BOOST_REQUIRE(writer.size() == stream.size());
+        BOOST_TEST(std::string(writer.data(), writer.size()) == std::string(stream.data(), stream.size()));
+
+        buffertest::Reading decoded;
+        ashdb::BufferReader reader{ writer.data(), writer.size() };
+        ashdb_read(reader, decoded);
+        BOOST_TEST((decoded == reading));
+        BOOST_TEST(reader.remaining() == 0u);
+
+        // a truncated record can't be read
+        ashdb::BufferReader truncated{ writer.data(), writer.size() - 1 };
+        BOOST_CHECK_THROW(ashdb_read(truncated, decoded), std::runtime_error);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(buffer_serialized_records)
+{
+    auto tempFolder = ashdb::test::tempFolder("buffer_serialized_records");
+
+    ashdb::Options options;
+    options.filesize_max = 1024;
+
+    {
+        ashdb::AshDB<buffertest::Reading> db{ tempFolder, options };
+        BOOST_TEST(db.open() == ashdb::OpenStatus::OK);
+
+        for (auto i = 0u; i < 100u; ++i)
+        {
+            BOOST_TEST(db.write(buffertest::Reading::Create(i)) == ashdb::WriteStatus::OK);
+        }
+
+        ashdb::AshDB<buffertest::Reading>::Batch batch;
+        for (auto i = 100u; i < 300u; ++i)
+        {
+            batch.push_back(buffertest::Reading::Create(i));
+        }
+        BOOST_TEST(db.write(batch) == ashdb::WriteStatus::OK);
+        BOOST_TEST(db.activeSegmentNumber() > 0);
+    }
+
+    ashdb::AshDB<buffertest::Reading> db{ tempFolder, options };
+    BOOST_TEST(db.open() == ashdb::OpenStatus::OK);
+    BOOST_TEST(db.size() == 300u);
+
+    const auto records = db.read(0, 300);
+    for (auto i = 0u; i < records.size(); ++i)
+    {
+        BOOST_TEST((records[i] == buffertest::Reading::Create(i)));
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,220 @@
+#include <filesystem>
+#include <fstream>
+#include <random>
+
+#include <boost/test/unit_test.hpp>
+#include <boost/test/data/test_case.hpp>
+
+#include "../include/ashdb/ashdb.h"
+#include "../include/ashdb/crc32c.h"
+
+#include "Test.h"
+#include "Person.h"
+
+namespace data = boost::unit_test::data;
+namespace fs = std::filesystem;
+
+BOOST_TEST_DONT_PRINT_LOG_VALUE(ashdb::Compression)
+BOOST_TEST_DONT_PRINT_LOG_VALUE(ashdb::ChecksumVerification)
+
+namespace
+{
+
+void flipByte(const std::string& filename, std::uint64_t offset)
+{
+    std::fstream file{ filename, std::ios::in | std::ios::out | std::ios::binary };
+    file.seekg(static_cast<std::streamoff>(offset));
+    const auto byte = static_cast<char>(file.get() ^ 0x20);
+    file.seekp(static_cast<std::streamoff>(offset));
+    file.put(byte);
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(checksum)
+
+BOOST_AUTO_TEST_CASE(crc32c)
+{
+    const std::string check{ "123456789" };
+    BOOST_TEST(ashdb::Crc32c(check.data(), check.size()) == 0xE3069283u);
+    BOOST_TEST(ashdb::Crc32cPortable(check.data(), check.size()) == 0xE3069283u);
+    BOOST_TEST(ashdb::Crc32c(nullptr, 0) == 0u);
+
+    const std::string zeros(32, '\0');
+    BOOST_TEST(ashdb::Crc32c(zeros.data(), zeros.size()) == 0x8A9136AAu);
+
+    std::mt19937 gen(1234);
+    std::uniform_int_distribution<int> byte(0, 255);
+    std::string random;
+    for (auto i = 0; i < 1000; ++i)
+    {
+        random.push_back(static_cast<char>(byte(gen)));
+    }
+
+    // every alignment and length, both at once and in two pieces
+    for (auto start = 0u; start < 8; ++start)
+    {
+        for (auto size = 0u; size < 200; ++size)
+        {
+            const auto data = random.data() + start;
+            const auto crc = ashdb::Crc32c(data, size);
+            BOOST_REQUIRE(ashdb::Crc32cPortable(data, size) == crc);
+
+            const auto split = size / 3;
+            BOOST_REQUIRE(ashdb::Crc32c(data + split, size - split, ashdb::Crc32c(data, split)) == crc);
+        }
+    }
+}
+
+BOOST_DATA_TEST_CASE(checksum_records,
+    data::make({ ashdb::Compression::NONE, ashdb::Compression::LZ }),
+    compression)
+{
+    auto tempFolder = ashdb::test::tempFolder("checksum_records");
+
+    ashdb::Options options;
+    options.filesize_max = 16 * 1024;
+    options.checksums = true;
+    options.compression = compression;
+
+    project::PersonDB db{ tempFolder, options };
+    BOOST_TEST(db.open() == ashdb::OpenStatus::OK);
+
+    project::PersonDB::Batch batch;
+    for (auto i = 0u; i < 2000; ++i)
+    {
+        batch.push_back(project::Person::CreatePerson(i));
+    }
+    BOOST_TEST(db.write(batch) == ashdb::WriteStatus::OK);
+
+    for (auto i = 2000u; i < 2100; ++i)
+    {
+        BOOST_TEST(db.write(project::Person::CreatePerson(i)) == ashdb::WriteStatus::OK);
+    }
+    BOOST_TEST(db.segmentIndices().size() > 1u);
+
+    BOOST_TEST((db.read(0) == project::Person::CreatePerson(0)));
+    BOOST_TEST((db.read(2099) == project::Person::CreatePerson(2099)));
+
+    const auto records = db.read(0, 2100);
+    for (auto i = 0u; i < records.size(); ++i)
+    {
+        BOOST_REQUIRE((records[i] == project::Person::CreatePerson(i)));
+    }
+
+    // the visitor is given the record without its checksum
+    db.scan(10, 20, [](std::size_t index, std::string_view bytes)
+    {
+        BOOST_TEST((project::PersonDB::decode(bytes) == project::Person::CreatePerson(index)));
+    });
+
+    db.close();
+    BOOST_TEST(db.open() == ashdb::OpenStatus::OK);
+
+    std::size_t index = 0;
+    for (const auto& person : db)
+    {
+        BOOST_REQUIRE((person == project::Person::CreatePerson(index++)));
+    }
+    BOOST_TEST(index == 2100u);
+}
+
+BOOST_DATA_TEST_CASE(checksum_raw_records, data::make({ 0u, 4u }), fixedSize)
+{
+    auto tempFolder = ashdb::test::tempFolder("checksum_raw_records");
+
+    ashdb::Options options;
+    options.filesize_max = 4096;
+    options.checksums = true;
+    options.fixed_record_size = fixedSize;
+
+    ashdb::AshDB<std::uint32_t> db{ tempFolder, options };
+    BOOST_TEST(db.open() == ashdb::OpenStatus::OK);
+
+    ashdb::AshDB<std::uint32_t>::Batch batch;
+    for (auto i = 0u; i < 5000; ++i)
+    {
+        batch.push_back(i * 7);
+    }
+    BOOST_TEST(db.write(batch) == ashdb::WriteStatus::OK);
+    BOOST_TEST(db.write(35000u) == ashdb::WriteStatus::OK);
+    batch.push_back(35000u);
+
+    BOOST_TEST(db.read(0, batch.size()) == batch);
+    BOOST_TEST(db.read(4321) == 4321u * 7);
+    BOOST_TEST(db.read(5000) == 35000u);
+
+    // every record is followed by its checksum
+    const auto headers = fixedSize > 0 ? db.segmentIndices().size() * ashdb::FIXED_HEADER_SIZE : 0;
+    BOOST_TEST(db.databaseSize() == (batch.size() * 8) + headers);
+
+    db.close();
+    BOOST_TEST(db.open() == ashdb::OpenStatus::OK);
+    BOOST_TEST(db.read(0, batch.size()) == batch);
+}
+
+BOOST_DATA_TEST_CASE(checksum_mismatch,
+    data::make({ ashdb::ChecksumVerification::NONE,
+                 ashdb::ChecksumVerification::ACTIVE_SEGMENT,
+                 ashdb::ChecksumVerification::ALL }),
+    verification)
+{
+    auto tempFolder = ashdb::test::tempFolder("checksum_mismatch");
+
+    ashdb::Options options;
+    options.filesize_max = 4096;
+    options.checksums = true;
+    options.verify_checksums = verification;
+
+    std::string sealedFile;
+    std::string activeFile;
+    std::size_t activeFirst = 0;
+    {
+        project::PersonDB db{ tempFolder, options };
+        BOOST_TEST(db.open() == ashdb::OpenStatus::OK);
+        for (auto i = 0u; i < 200; ++i)
+        {
+            BOOST_TEST(db.write(project::Person::CreatePerson(i)) == ashdb::WriteStatus::OK);
+        }
+
+        sealedFile = ashdb::BuildFilename(tempFolder, options.prefix, options.extension, db.startSegmentNumber());
+        activeFile = db.activeDataFile();
+        activeFirst = db.segmentIndices().back().at(0);
+    }
+
+    // somewhere in the name of the first record of both segments
+    flipByte(sealedFile, 12);
+    flipByte(activeFile, 12);
+
+    project::PersonDB db{ tempFolder, options };
+    BOOST_TEST(db.open() == ashdb::OpenStatus::OK);
+
+    const bool sealedChecked = verification == ashdb::ChecksumVerification::ALL;
+    const bool activeChecked = verification != ashdb::ChecksumVerification::NONE;
+
+    if (sealedChecked)
+    {
+        BOOST_CHECK_THROW(db.read(0), std::runtime_error);
+        BOOST_CHECK_THROW(db.read(0, 2), std::runtime_error);
+        BOOST_CHECK_THROW(db.scan(0, 1, [](std::size_t, std::string_view) {}), std::runtime_error);
+    }
+    else
+    {
+        BOOST_TEST(!(db.read(0) == project::Person::CreatePerson(0)));
+    }
+
+    if (activeChecked)
+    {
+        BOOST_CHECK_THROW(db.read(activeFirst), std::runtime_error);
+    }
+    else
+    {
+        BOOST_TEST(!(db.read(activeFirst) == project::Person::CreatePerson(activeFirst)));
+    }
+
+    // the records around them are fine
+    BOOST_TEST((db.read(1) == project::Person::CreatePerson(1)));
+    BOOST_TEST((db.read(activeFirst + 1) == project::Person::CreatePerson(activeFirst + 1)));
+}
+
+BOOST_AUTO_TEST_SUITE_END() // checksum
@@ -0,0 +1,345 @@
+#include <filesystem>
+#include <fstream>
+#include <random>
+
+#include <boost/test/unit_test.hpp>
+#include <boost/test/data/test_case.hpp>
+
+#include "../include/ashdb/ashdb.h"
+#include "../include/ashdb/compression.h"
+
+#include "Test.h"
+#include "Person.h"
+
+namespace data = boost::unit_test::data;
+namespace fs = std::filesystem;
+
+BOOST_AUTO_TEST_SUITE(compression)
+
+BOOST_AUTO_TEST_CASE(lz_codec)
+{
+    std::mt19937 gen(1234);
+    std::uniform_int_distribution<int> byte(0, 255);
+
+    std::vector<std::string> inputs;
+    inputs.push_back("a");
+    inputs.push_back("abc");
+    inputs.push_back(std::string(100000, 'x'));
+    inputs.push_back(piStr);
+
+    std::string random;
+    for (auto i = 0; i < 70000; ++i)
+    {
+        random.push_back(static_cast<char>(byte(gen)));
+    }
+    inputs.push_back(random);
+
+    // repeats further back than a match can reach
+    inputs.push_back(random + random);
+
+    std::string text;
+    for (auto i = 0; i < 5000; ++i)
+    {
+        text += "Firstname" + std::to_string(i) + " Lastname" + std::to_string(i % 7) + ";";
+    }
+    inputs.push_back(text);
+
+    const ashdb::LZCodec codec;
+    for (const auto& input : inputs)
+    {
+        std::string compressed{ "prefix" };
+        codec.compress(input.data(), input.size(), compressed);
+        BOOST_TEST(compressed.substr(0, 6) == "prefix");
+
+        std::string output(input.size(), '\0');
+        codec.decompress(compressed.data() + 6, compressed.size() - 6, output.data(), output.size());
+        BOOST_TEST(output == input);
+
+        // the whole block must be decompressed to exactly the given size
+        std::string longer(input.size() + 1, '\0');
+        BOOST_CHECK_THROW(codec.decompress(compressed.data() + 6, compressed.size() - 6,
+                                           longer.data(), longer.size()), std::runtime_error);
+        BOOST_CHECK_THROW(codec.decompress(compressed.data() + 6, compressed.size() - 7,
+                                           output.data(), output.size()), std::runtime_error);
+    }
+
+    std::string compressed;
+    codec.compress(inputs[2].data(), inputs[2].size(), compressed);
+    BOOST_TEST(compressed.size() < 1000u);
+
+    // blocks that don't get smaller are stored as they are
+    std::string block;
+    ashdb::AppendBlock(codec, random.data(), random.size(), block);
+    BOOST_TEST(block.size() == random.size() + ashdb::BLOCK_HEADER_SIZE);
+
+    std::string output(random.size(), '\0');
+    ashdb::DecodeBlock(codec, block.data() + ashdb::BLOCK_HEADER_SIZE,
+                       block.size() - ashdb::BLOCK_HEADER_SIZE, output.data(), output.size());
+    BOOST_TEST(output == random);
+}
+
+BOOST_DATA_TEST_CASE(compressed_records,
+    data::make({ 0u, 4096u }) * data::make({ 512u, 64u * 1024u }),
+    bufferSize, blockSize)
+{
+    auto tempFolder = ashdb::test::tempFolder("compressed_records");
+
+    ashdb::Options options;
+    options.filesize_max = 64 * 1024;
+    options.write_buffer_size = bufferSize;
+    options.compression = ashdb::Compression::LZ;
+    options.compression_block_size = blockSize;
+
+    std::uint64_t uncompressed = 0;
+    {
+        project::PersonDB db{ tempFolder, options };
+        BOOST_TEST(db.open() == ashdb::OpenStatus::OK);
+
+        project::PersonDB::Batch batch;
+        for (auto i = 0u; i < 20000; ++i)
+        {
+            batch.push_back(project::Person::CreatePerson(i));
+
+            std::stringstream stream;
+            ashdb_write(stream, batch.back());
+            uncompressed += stream.str().size();
+        }
+        BOOST_TEST(db.write(batch) == ashdb::WriteStatus::OK);
+
+        for (auto i = 20000u; i < 21000; ++i)
+        {
+            BOOST_TEST(db.write(project::Person::CreatePerson(i)) == ashdb::WriteStatus::OK);
+        }
+
+        BOOST_TEST(db.size() == 21000u);
+        BOOST_TEST(db.databaseSize() * 2 < uncompressed);
+
+        // records of sealed blocks, buffered records and records that span
+        // blocks and segments
+        for (const auto i : { 0u, 1u, 999u, 12345u, 19999u, 20000u, 20999u })
+        {
+            BOOST_TEST((db.read(i) == project::Person::CreatePerson(i)));
+        }
+
+        const auto batchRead = db.read(100, 20900);
+        for (auto i = 0u; i < batchRead.size(); ++i)
+        {
+            BOOST_REQUIRE((batchRead[i] == project::Person::CreatePerson(i + 100)));
+        }
+    }
+
+    // the segments are only filled up to `filesize_max` compressed bytes
+    // with up to two blocks of records more before they are compressed
+    for (const auto& entry : fs::directory_iterator(tempFolder))
+    {
+        if (entry.path().extension() == ".ash")
+        {
+            BOOST_TEST(entry.file_size() <= options.filesize_max + (2 * blockSize) + 1024);
+        }
+    }
+
+    project::PersonDB db{ tempFolder, options };
+    BOOST_TEST(db.open() == ashdb::OpenStatus::OK);
+    BOOST_TEST(db.size() == 21000u);
+    BOOST_TEST(db.segmentIndices().size() < uncompressed / options.filesize_max);
+
+    std::size_t index = 0;
+    for (const auto& person : db)
+    {
+        BOOST_REQUIRE((person == project::Person::CreatePerson(index++)));
+    }
+    BOOST_TEST(index == 21000u);
+
+    // appending to the reopened active segment
+    BOOST_TEST(db.write(project::Person::CreatePerson(21000)) == ashdb::WriteStatus::OK);
+    BOOST_TEST((db.read(21000) == project::Person::CreatePerson(21000)));
+    BOOST_TEST((db.read(20999) == project::Person::CreatePerson(20999)));
+}
+
+BOOST_AUTO_TEST_CASE(compressed_raw_records)
+{
+    auto tempFolder = ashdb::test::tempFolder("compressed_raw_records");
+
+    ashdb::Options options;
+    options.filesize_max = 16 * 1024;
+    options.compression = ashdb::Compression::LZ;
+    options.compression_block_size = 4096;
+
+    ashdb::AshDB<std::uint32_t> db{ tempFolder, options };
+    BOOST_TEST(db.open() == ashdb::OpenStatus::OK);
+
+    ashdb::AshDB<std::uint32_t>::Batch batch;
+    for (auto i = 0u; i < 100000; ++i)
+    {
+        batch.push_back(i / 4);
+    }
+    BOOST_TEST(db.write(batch) == ashdb::WriteStatus::OK);
+
+    // far fewer segments than the 25 the uncompressed records would need
+    BOOST_TEST(db.segmentIndices().size() > 1u);
+    BOOST_TEST(db.segmentIndices().size() < 20u);
+    BOOST_TEST(db.databaseSize() < 300000u);
+
+    BOOST_TEST(db.read(0, 100000) == batch);
+    BOOST_TEST(db.read(54321) == 13580u);
+
+    std::uint64_t sum = 0;
+    db.scan(0, db.size(), [&sum](std::size_t, std::string_view bytes)
+    {
+        sum += ashdb::AshDB<std::uint32_t>::decode(bytes);
+    });
+    BOOST_TEST(sum == 4ull * (24999ull * 25000ull / 2));
+}
+
+BOOST_AUTO_TEST_CASE(compressed_retention)
+{
+    auto tempFolder = ashdb::test::tempFolder("compressed_retention");
+
+    ashdb::Options options;
+    options.filesize_max = 32 * 1024;
+    options.database_max = 128 * 1024;
+    options.compression = ashdb::Compression::LZ;
+    options.compression_block_size = 4096;
+
+    project::PersonDB db{ tempFolder, options };
+    BOOST_TEST(db.open() == ashdb::OpenStatus::OK);
+
+    for (auto i = 0u; i < 40000; ++i)
+    {
+        BOOST_REQUIRE(db.write(project::Person::CreatePerson(i)) == ashdb::WriteStatus::OK);
+    }
+
+    BOOST_TEST(db.databaseSize() <= options.database_max);
+    BOOST_TEST(db.startIndex().value() > 0u);
+    BOOST_TEST(db.lastIndex().value() == 39999u);
+
+    const auto first = db.startIndex().value();
+    const auto records = db.read(first, db.size());
+    for (auto i = 0u; i < records.size(); ++i)
+    {
+        BOOST_REQUIRE((records[i] == project::Person::CreatePerson(first + i)));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(compressed_truncate)
+{
+    auto tempFolder = ashdb::test::tempFolder("compressed_truncate");
+
+    ashdb::Options options;
+    options.filesize_max = 16 * 1024;
+    options.compression = ashdb::Compression::LZ;
+    options.compression_block_size = 2048;
+
+    project::PersonDB db{ tempFolder, options };
+    BOOST_TEST(db.open() == ashdb::OpenStatus::OK);
+
+    project::PersonDB::Batch batch;
+    for (auto i = 0u; i < 5000; ++i)
+    {
+        batch.push_back(project::Person::CreatePerson(i));
+    }
+    BOOST_TEST(db.write(batch) == ashdb::WriteStatus::OK);
+    BOOST_TEST(db.segmentIndices().size() > 2u);
+
+    // cuts through the middle of a block of a sealed segment
+    const auto cut = db.segmentIndices().front().size() + 17;
+    db.truncate(cut);
+    BOOST_TEST(db.lastIndex().value() == cut - 1);
+    BOOST_TEST((db.read(cut - 1) == project::Person::CreatePerson(cut - 1)));
+
+    for (auto i = cut; i < cut + 100; ++i)
+    {
+        BOOST_TEST(db.write(project::Person::CreatePerson(i)) == ashdb::WriteStatus::OK);
+    }
+
+    db.close();
+    BOOST_TEST(db.open() == ashdb::OpenStatus::OK);
+
+    const auto records = db.read(0, cut + 100);
+    for (auto i = 0u; i < records.size(); ++i)
+    {
+        BOOST_REQUIRE((records[i] == project::Person::CreatePerson(i)));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(compressed_partial_block)
+{
+    auto tempFolder = ashdb::test::tempFolder("compressed_partial_block");
+
+    ashdb::Options options;
+    options.compression = ashdb::Compression::LZ;
+    options.compression_block_size = 1024;
+
+    std::string datafile;
+    {
+        project::PersonDB db{ tempFolder, options };
+        BOOST_TEST(db.open() == ashdb::OpenStatus::OK);
+        for (auto i = 0u; i < 500; ++i)
+        {
+            BOOST_TEST(db.write(project::Person::CreatePerson(i)) == ashdb::WriteStatus::OK);
+        }
+        datafile = db.activeDataFile();
+    }
+
+    // the start of a block that was never finished
+    const auto size = fs::file_size(datafile);
+    {
+        std::ofstream out{ datafile, std::ios::binary | std::ios::app };
+        const std::uint32_t header[2] = { 400, 800 };
+        out.write(reinterpret_cast<const char*>(header), sizeof(header));
+        out.write(piStr, 100);
+    }
+
+    project::PersonDB db{ tempFolder, options };
+    BOOST_TEST(db.open() == ashdb::OpenStatus::OK);
+    BOOST_TEST(db.size() == 500u);
+    BOOST_TEST((db.read(499) == project::Person::CreatePerson(499)));
+
+    BOOST_TEST(db.write(project::Person::CreatePerson(500)) == ashdb::WriteStatus::OK);
+    db.close();
+    BOOST_TEST(fs::file_size(datafile) > size);
+
+    BOOST_TEST(db.open() == ashdb::OpenStatus::OK);
+    const auto records = db.read(0, 501);
+    for (auto i = 0u; i < records.size(); ++i)
+    {
+        BOOST_REQUIRE((records[i] == project::Person::CreatePerson(i)));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(compressed_move)
+{
+    ashdb::Options options;
+    options.compression = ashdb::Compression::LZ;
+    options.compression_block_size = 1024;
+
+    const auto fill = [&options](const std::string& folder, char c)
+    {
+        ashdb::AshDB<std::string> db{ folder, options };
+        BOOST_TEST(db.open() == ashdb::OpenStatus::OK);
+        for (auto i = 0u; i < 100; ++i)
+        {
+            BOOST_TEST(db.write(std::string(50, c)) == ashdb::WriteStatus::OK);
+        }
+    };
+
+    const auto folderA = ashdb::test::tempFolder("compressed_move_a");
+    const auto folderB = ashdb::test::tempFolder("compressed_move_b");
+    fill(folderA, 'a');
+    fill(folderB, 'b');
+
+    ashdb::AshDB<std::string> dba{ folderA, options };
+    ashdb::AshDB<std::string> dbb{ folderB, options };
+    BOOST_TEST(dba.open() == ashdb::OpenStatus::OK);
+    BOOST_TEST(dbb.open() == ashdb::OpenStatus::OK);
+
+    // the moved databases must not share the blocks they have cached
+    ashdb::AshDB<std::string> a1{ std::move(dba) };
+    ashdb::AshDB<std::string> b1{ std::move(dbb) };
+    BOOST_TEST(a1.read(0) == std::string(50, 'a'));
+    BOOST_TEST(b1.read(0) == std::string(50, 'b'));
+    BOOST_TEST(a1.read(99) == std::string(50, 'a'));
+    BOOST_TEST(b1.read(99) == std::string(50, 'b'));
+}
+
+BOOST_AUTO_TEST_SUITE_END() // compression
@@ -0,0 +1,555 @@
+#include <filesystem>
+#include <random>
+
+#include <boost/test/unit_test.hpp>
+#include <boost/test/data/test_case.hpp>
+
+#include "../include/ashdb/ashdb.h"
+#include "../include/ashdb/eliasfano.h"
+#include "../include/ashdb/segmentindex.h"
+
+#include "Test.h"
+#include "Person.h"
+
+namespace data = boost::unit_test::data;
+
+BOOST_TEST_DONT_PRINT_LOG_VALUE(ashdb::IndexEncoding)
+BOOST_TEST_DONT_PRINT_LOG_VALUE(ashdb::Compression)
+
+namespace
+{
+
+// turns a sealed segment into one that was sealed without a footer, with its
+// offsets in an index file
+void removeFooter(const std::string& datafile, const std::string& indexfile)
+{
+    std::vector<std::size_t> entries;
+    std::uint64_t dataSize = 0;
+    {
+        const ashdb::File file{ datafile, ashdb::File::Mode::Read };
+        const auto footer = ashdb::ReadSegmentFooter(file);
+        BOOST_REQUIRE(footer.has_value());
+        entries = ashdb::ReadSegmentFooterEntries(file, *footer);
+        dataSize = footer->dataSize;
+    }
+
+    ashdb::File index{ indexfile, ashdb::File::Mode::Append };
+    index.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(std::size_t));
+    std::filesystem::resize_file(datafile, dataSize);
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(index_suite)
+
+BOOST_AUTO_TEST_CASE(elias_fano)
+{
+    std::mt19937 gen(1234);
+    std::uniform_int_distribution<std::uint64_t> distrib(0, 300);
+
+    for (const auto count : { 1u, 2u, 63u, 64u, 65u, 255u, 256u, 257u, 10000u })
+    {
+        std::vector<std::uint64_t> values;
+        std::uint64_t current = 0;
+        for (auto i = 0u; i < count; ++i)
+        {
+            values.push_back(current);
+            current += distrib(gen);
+        }
+
+        ashdb::EliasFano ef{ values };
+        BOOST_TEST(ef.size() == values.size());
+        for (auto i = 0u; i < values.size(); ++i)
+        {
+            BOOST_TEST(ef.at(i) == values[i]);
+        }
+
+        BOOST_CHECK_THROW(ef.at(values.size()), std::out_of_range);
+    }
+
+    // repeated values and large gaps
+    std::vector<std::uint64_t> values { 0, 0, 0, 7, 7, 1ull << 40, (1ull << 40) + 1 };
+    ashdb::EliasFano ef{ values };
+    for (auto i = 0u; i < values.size(); ++i)
+    {
+        BOOST_TEST(ef.at(i) == values[i]);
+    }
+
+    BOOST_CHECK_THROW(ashdb::EliasFano(std::vector<std::uint64_t>{ 5, 4 }), std::runtime_error);
+}
+
+BOOST_DATA_TEST_CASE(segment_index_encodings,
+    data::make({ ashdb::IndexEncoding::PLAIN,
+                 ashdb::IndexEncoding::RELATIVE32,
+                 ashdb::IndexEncoding::ELIAS_FANO }),
+    encoding)
+{
+    std::vector<std::size_t> entries{ 500 };
+    for (auto i = 1u; i < 1000; ++i)
+    {
+        entries.push_back(i * 17);
+    }
+
+    ashdb::SegmentIndex index{ entries, encoding };
+    BOOST_TEST(index.size() == entries.size());
+    BOOST_TEST(index.front() == 500);
+    BOOST_TEST(index.offset(0) == 0);
+
+    index.seal();
+    for (auto i = 0u; i < entries.size(); ++i)
+    {
+        BOOST_TEST(index[i] == entries[i]);
+    }
+
+    BOOST_CHECK_THROW(index.at(entries.size()), std::out_of_range);
+
+    if (encoding == ashdb::IndexEncoding::ELIAS_FANO)
+    {
+        BOOST_CHECK_THROW(index.push_back(17000), std::runtime_error);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(segment_index_widen)
+{
+    ashdb::SegmentIndex index{ ashdb::IndexEncoding::RELATIVE32 };
+    index.push_back(10);
+    index.push_back(100);
+
+    // an offset past 4GB can't be stored in 32-bits
+    const std::size_t big = (1ull << 33) + 5;
+    index.push_back(big);
+    index.push_back(big + 10);
+
+    BOOST_TEST(index.size() == 4);
+    BOOST_TEST(index[0] == 10);
+    BOOST_TEST(index[1] == 100);
+    BOOST_TEST(index[2] == big);
+    BOOST_TEST(index[3] == big + 10);
+}
+
+BOOST_AUTO_TEST_CASE(segment_index_memory)
+{
+    std::vector<std::size_t> entries{ 0 };
+    for (auto i = 1u; i < 100000; ++i)
+    {
+        entries.push_back(i * 12);
+    }
+
+    ashdb::SegmentIndex plain{ entries, ashdb::IndexEncoding::PLAIN };
+    ashdb::SegmentIndex relative{ entries, ashdb::IndexEncoding::RELATIVE32 };
+    ashdb::SegmentIndex packed{ entries, ashdb::IndexEncoding::ELIAS_FANO };
+    packed.seal();
+
+    BOOST_TEST(relative.memoryUsage() * 10 <= plain.memoryUsage() * 6);
+    BOOST_TEST(packed.memoryUsage() * 8 <= plain.memoryUsage());
+}
+
+BOOST_DATA_TEST_CASE(db_index_encodings,
+    data::make({ ashdb::IndexEncoding::PLAIN,
+                 ashdb::IndexEncoding::RELATIVE32,
+                 ashdb::IndexEncoding::ELIAS_FANO }),
+    encoding)
+{
+    auto tempFolder = ashdb::test::tempFolder("db_index_encodings");
+
+    ashdb::Options options;
+    options.filesize_max = 1024;
+    options.index_encoding = encoding;
+
+    auto db = std::make_unique<project::PersonDB>(tempFolder, options);
+    BOOST_TEST(db->open() == ashdb::OpenStatus::OK);
+
+    for (auto i = 0u; i < 50; ++i)
+    {
+        BOOST_TEST(db->write(project::Person::CreatePerson(i)) == ashdb::WriteStatus::OK);
+    }
+
+    project::PersonDB::Batch batch;
+    for (auto i = 50u; i < 100; ++i)
+    {
+        batch.push_back(project::Person::CreatePerson(i));
+    }
+    BOOST_TEST(db->write(batch) == ashdb::WriteStatus::OK);
+
+    for (auto i = 0u; i < 100; ++i)
+    {
+        BOOST_TEST((db->read(i) == project::Person::CreatePerson(i)));
+    }
+
+    db->close();
+    BOOST_TEST(db->open() == ashdb::OpenStatus::OK);
+    BOOST_TEST(db->size() == 100);
+
+    const auto records = db->read(0, 100);
+    for (auto i = 0u; i < records.size(); ++i)
+    {
+        BOOST_TEST((records[i] == project::Person::CreatePerson(i)));
+    }
+
+    db->truncate(33);
+    BOOST_TEST(db->size() == 33);
+    BOOST_TEST((db->read(32) == project::Person::CreatePerson(32)));
+}
+
+BOOST_AUTO_TEST_CASE(lazy_loading)
+{
+    auto tempFolder = ashdb::test::tempFolder("lazy_loading");
+
+    ashdb::Options options;
+    options.filesize_max = 512;
+
+    auto db = std::make_unique<project::PersonDB>(tempFolder, options);
+    BOOST_TEST(db->open() == ashdb::OpenStatus::OK);
+
+    project::PersonDB::Batch batch;
+    for (auto i = 0u; i < 500; ++i)
+    {
+        batch.push_back(project::Person::CreatePerson(i));
+    }
+    BOOST_TEST(db->write(batch) == ashdb::WriteStatus::OK);
+    const auto eagerMemory = db->indexMemoryUsage();
+    db->close();
+
+    options.lazy_index_loading = true;
+    db = std::make_unique<project::PersonDB>(tempFolder, options);
+    BOOST_TEST(db->open() == ashdb::OpenStatus::OK);
+    BOOST_TEST(db->size() == 500);
+    BOOST_TEST(db->segmentIndices().size() > 10);
+    const auto lazyMemory = db->indexMemoryUsage();
+    BOOST_TEST(lazyMemory < eagerMemory);
+
+    // the segment sizes are known without loading the offsets
+    std::size_t total = 0;
+    for (const auto& index : db->segmentIndices())
+    {
+        total += index.size();
+    }
+    BOOST_TEST(total == 500);
+
+    for (auto i = 0u; i < 500; i += 7)
+    {
+        BOOST_TEST((db->read(i) == project::Person::CreatePerson(i)));
+    }
+
+    const auto records = db->read(100, 300);
+    for (auto i = 0u; i < records.size(); ++i)
+    {
+        BOOST_TEST((records[i] == project::Person::CreatePerson(i + 100)));
+    }
+
+    // every segment has been read, so all of the offsets are loaded
+    BOOST_TEST(db->indexMemoryUsage() > lazyMemory);
+    BOOST_TEST(db->indexMemoryUsage() <= eagerMemory);
+
+    // keep writing after a lazy open
+    for (auto i = 500u; i < 600; ++i)
+    {
+        BOOST_TEST(db->write(project::Person::CreatePerson(i)) == ashdb::WriteStatus::OK);
+    }
+
+    db->truncate(250);
+    BOOST_TEST(db->size() == 250);
+    BOOST_TEST((db->read(249) == project::Person::CreatePerson(249)));
+    BOOST_TEST((db->read(3) == project::Person::CreatePerson(3)));
+}
+
+BOOST_AUTO_TEST_CASE(lazy_loading_budget)
+{
+    auto tempFolder = ashdb::test::tempFolder("lazy_loading_budget");
+
+    ashdb::Options options;
+    options.filesize_max = 4096;
+    options.index_encoding = ashdb::IndexEncoding::PLAIN;
+
+    auto db = std::make_unique<ashdb::AshDB<std::uint64_t>>(tempFolder, options);
+    BOOST_TEST(db->open() == ashdb::OpenStatus::OK);
+
+    ashdb::AshDB<std::uint64_t>::Batch batch;
+    for (auto i = 0u; i < 20000; ++i)
+    {
+        batch.push_back(i);
+    }
+    BOOST_TEST(db->write(batch) == ashdb::WriteStatus::OK);
+    db->close();
+
+    // each segment holds 512 records, so this budget fits only a few
+    // of the loaded segment indices
+    options.lazy_index_loading = true;
+    options.index_memory_budget = 16 * 1024;
+    db = std::make_unique<ashdb::AshDB<std::uint64_t>>(tempFolder, options);
+    BOOST_TEST(db->open() == ashdb::OpenStatus::OK);
+
+    const auto unloadedMemory = db->indexMemoryUsage();
+    for (auto i = 0u; i < 20000; i += 13)
+    {
+        BOOST_TEST(db->read(i) == i);
+        BOOST_TEST(db->indexMemoryUsage() <= unloadedMemory + options.index_memory_budget + 8192);
+    }
+
+    // read everything once more after most of the segments were unloaded
+    const auto records = db->read(0, 20000);
+    for (auto i = 0u; i < records.size(); ++i)
+    {
+        BOOST_TEST(records[i] == i);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(fixed_records)
+{
+    auto tempFolder = ashdb::test::tempFolder("fixed_records");
+
+    ashdb::Options options;
+    options.filesize_max = 4096;
+    options.fixed_record_size = sizeof(std::uint64_t);
+
+    {
+        ashdb::AshDB<std::uint64_t> db{ tempFolder, options };
+        BOOST_TEST(db.open() == ashdb::OpenStatus::OK);
+
+        ashdb::AshDB<std::uint64_t>::Batch batch;
+        for (auto i = 0u; i < 2000; ++i)
+        {
+            batch.push_back(i);
+        }
+        BOOST_TEST(db.write(batch) == ashdb::WriteStatus::OK);
+        for (auto i = 2000u; i < 2100; ++i)
+        {
+            BOOST_TEST(db.write(i) == ashdb::WriteStatus::OK);
+        }
+        BOOST_TEST(db.size() == 2100u);
+        BOOST_TEST(db.read(1234) == 1234u);
+    }
+
+    // none of the segments have an index file
+    std::size_t segments = 0;
+    for (const auto& entry : std::filesystem::directory_iterator{ tempFolder })
+    {
+        BOOST_TEST(entry.path().extension() != ".ashidx");
+        segments++;
+    }
+    BOOST_TEST(segments > 1u);
+
+    // cut the last record in half as if the write never completed
+    {
+        ashdb::AshDB<std::uint64_t> db{ tempFolder, options };
+        BOOST_TEST(db.open() == ashdb::OpenStatus::OK);
+        const auto datafile = db.activeDataFile();
+        db.close();
+        std::filesystem::resize_file(datafile, std::filesystem::file_size(datafile) - 4);
+    }
+
+    ashdb::AshDB<std::uint64_t> db{ tempFolder, options };
+    BOOST_TEST(db.open() == ashdb::OpenStatus::OK);
+    BOOST_TEST(db.size() == 2099u);
+
+    const auto records = db.read(0, db.size());
+    for (auto i = 0u; i < records.size(); ++i)
+    {
+        BOOST_TEST(records[i] == i);
+    }
+
+    // the next record is written where the partial one was
+    BOOST_TEST(db.write(9999u) == ashdb::WriteStatus::OK);
+    BOOST_TEST(db.read(2099) == 9999u);
+
+    db.truncate(1500);
+    BOOST_TEST(db.size() == 1500u);
+    BOOST_TEST(db.write(1500u) == ashdb::WriteStatus::OK);
+    BOOST_TEST(db.read(1499) == 1499u);
+    BOOST_TEST(db.read(1500) == 1500u);
+}
+
+BOOST_AUTO_TEST_CASE(fixed_records_invalid_size)
+{
+    auto tempFolder = ashdb::test::tempFolder("fixed_records_invalid_size");
+
+    // a string of four characters is stored as its length and its characters
+    ashdb::Options options;
+    options.fixed_record_size = sizeof(std::uint32_t) + 4;
+
+    ashdb::AshDB<std::string> db{ tempFolder, options };
+    BOOST_TEST(db.open() == ashdb::OpenStatus::OK);
+    BOOST_TEST(db.write("abcd") == ashdb::WriteStatus::OK);
+    BOOST_TEST(db.write("abc") == ashdb::WriteStatus::INVALID_RECORD_SIZE);
+
+    // the records of a batch before the invalid one are still written
+    BOOST_TEST(db.write({ "efgh", "ijklm", "nopq" }) == ashdb::WriteStatus::INVALID_RECORD_SIZE);
+    BOOST_TEST(db.size() == 2u);
+    BOOST_TEST(db.read(1) == "efgh");
+
+    const auto result = db.writeAsync("rstu").get();
+    BOOST_TEST(result.status == ashdb::WriteStatus::OK);
+    BOOST_TEST(*(result.index) == 2u);
+
+    // raw records can only be stored if they are exactly the fixed size
+    ashdb::AshDB<std::uint16_t> raw{ ashdb::test::tempFolder("fixed_records_invalid_raw"), options };
+    BOOST_TEST(raw.open() == ashdb::OpenStatus::OK);
+    BOOST_TEST(raw.write({ 1, 2, 3 }) == ashdb::WriteStatus::INVALID_RECORD_SIZE);
+    BOOST_TEST(raw.size() == 0u);
+}
+
+BOOST_AUTO_TEST_CASE(segment_footer)
+{
+    const std::vector<std::size_t> entries{ 1000, 40, 80, 120, 161, 200, 240 };
+
+    for (const auto compression : { ashdb::Compression::NONE, ashdb::Compression::LZ })
+    {
+        auto footer = ashdb::BuildSegmentFooter(entries, 280, compression);
+        const std::string data = std::string(280, 'x') + footer;
+
+        const auto parsed = ashdb::ParseSegmentFooter(data.data() + data.size() - ashdb::SEGMENT_FOOTER_SIZE,
+                                                      data.size());
+        BOOST_REQUIRE(parsed.has_value());
+        BOOST_TEST(parsed->first == 1000u);
+        BOOST_TEST(parsed->count == entries.size());
+        BOOST_TEST(parsed->dataSize == 280u);
+
+        // the fixed part must be at the very end of the file
+        BOOST_TEST(!ashdb::ParseSegmentFooter(data.data() + data.size() - ashdb::SEGMENT_FOOTER_SIZE,
+                                              data.size() + 1).has_value());
+
+        footer.back() = 'X';
+        BOOST_TEST(!ashdb::ParseSegmentFooter(footer.data() + footer.size() - ashdb::SEGMENT_FOOTER_SIZE,
+                                              data.size()).has_value());
+    }
+
+    const std::string records(280, 'x');
+    BOOST_TEST(!ashdb::ParseSegmentFooter(records.data() + records.size() - ashdb::SEGMENT_FOOTER_SIZE,
+                                          records.size()).has_value());
+}
+
+BOOST_DATA_TEST_CASE(sealed_segments,
+    data::make({ ashdb::Compression::NONE, ashdb::Compression::LZ }) * data::make({ false, true }),
+    compression, lazy)
+{
+    auto tempFolder = ashdb::test::tempFolder("sealed_segments");
+
+    ashdb::Options options;
+    options.filesize_max = 4096;
+    options.compression = compression;
+    options.compression_block_size = 1024;
+    options.lazy_index_loading = lazy;
+
+    project::PersonDB db{ tempFolder, options };
+    BOOST_TEST(db.open() == ashdb::OpenStatus::OK);
+    for (auto i = 0u; i < 2000; ++i)
+    {
+        BOOST_TEST(db.write(project::Person::CreatePerson(i)) == ashdb::WriteStatus::OK);
+    }
+    BOOST_TEST(db.segmentIndices().size() > 3u);
+
+    // only the active segment has an index file, and the footers are no
+    // more part of the database size than the index files are
+    std::uint64_t records = 0;
+    for (auto i = db.startSegmentNumber(); i < db.activeSegmentNumber(); ++i)
+    {
+        const auto datafile = ashdb::BuildFilename(tempFolder, options.prefix, options.extension, i);
+        const auto footer = ashdb::ReadSegmentFooter(ashdb::File{ datafile, ashdb::File::Mode::Read });
+        BOOST_REQUIRE(footer.has_value());
+        BOOST_TEST(footer->first == db.segmentIndices()[i - db.startSegmentNumber()].at(0));
+        BOOST_TEST(!std::filesystem::exists(datafile + "idx"));
+        records += std::filesystem::file_size(datafile) - footer->tableSize - ashdb::SEGMENT_FOOTER_SIZE;
+    }
+    BOOST_TEST(std::filesystem::exists(db.activeIndexFile()));
+
+    // records of a block that isn't compressed yet count at their full size
+    BOOST_TEST(db.databaseSize() >= records + std::filesystem::file_size(db.activeDataFile()));
+    db.close();
+    BOOST_TEST(db.open() == ashdb::OpenStatus::OK);
+    BOOST_TEST(db.databaseSize() == records + std::filesystem::file_size(db.activeDataFile()));
+
+    const auto check = [&db](std::size_t count)
+    {
+        const auto batch = db.read(0, count);
+        for (auto i = 0u; i < batch.size(); ++i)
+        {
+            BOOST_REQUIRE((batch[i] == project::Person::CreatePerson(i)));
+        }
+
+        std::size_t index = 0;
+        for (const auto& person : db)
+        {
+            BOOST_REQUIRE((person == project::Person::CreatePerson(index++)));
+        }
+        BOOST_TEST(index == count);
+    };
+    check(2000);
+
+    db.close();
+    BOOST_TEST(db.open() == ashdb::OpenStatus::OK);
+    BOOST_TEST(db.size() == 2000u);
+    check(2000);
+
+    // cutting a sealed segment short turns it back into the active segment
+    const auto cut = db.segmentIndices()[1].at(0) + 5;
+    db.truncate(cut);
+    BOOST_TEST(db.lastIndex().value() == cut - 1);
+    BOOST_TEST(std::filesystem::exists(db.activeIndexFile()));
+    BOOST_TEST(!ashdb::ReadSegmentFooter(ashdb::File{ db.activeDataFile(), ashdb::File::Mode::Read }).has_value());
+
+    for (auto i = cut; i < 2500; ++i)
+    {
+        BOOST_TEST(db.write(project::Person::CreatePerson(i)) == ashdb::WriteStatus::OK);
+    }
+    check(2500);
+
+    db.close();
+    BOOST_TEST(db.open() == ashdb::OpenStatus::OK);
+    check(2500);
+}
+
+BOOST_AUTO_TEST_CASE(sealed_segments_without_footer)
+{
+    auto tempFolder = ashdb::test::tempFolder("sealed_segments_without_footer");
+
+    ashdb::Options options;
+    options.filesize_max = 4096;
+
+    std::uint16_t start = 0;
+    std::uint16_t active = 0;
+    {
+        project::PersonDB db{ tempFolder, options };
+        BOOST_TEST(db.open() == ashdb::OpenStatus::OK);
+        for (auto i = 0u; i < 1000; ++i)
+        {
+            BOOST_TEST(db.write(project::Person::CreatePerson(i)) == ashdb::WriteStatus::OK);
+        }
+        start = db.startSegmentNumber();
+        active = db.activeSegmentNumber();
+    }
+    BOOST_REQUIRE(active - start > 2);
+
+    const auto datafile = [&](std::uint16_t segment)
+    {
+        return ashdb::BuildFilename(tempFolder, options.prefix, options.extension, segment);
+    };
+
+    // a database written before segments had footers, whose newest segment
+    // filled up just before the process died
+    for (auto i = start; i < active; ++i)
+    {
+        removeFooter(datafile(i), datafile(i) + "idx");
+    }
+    std::filesystem::remove(datafile(active));
+    std::filesystem::remove(datafile(active) + "idx");
+
+    project::PersonDB db{ tempFolder, options };
+    BOOST_TEST(db.open() == ashdb::OpenStatus::OK);
+    BOOST_TEST(db.activeSegmentNumber() == active);
+
+    // the full segment is sealed, the older ones are read as they are
+    BOOST_TEST(ashdb::ReadSegmentFooter(ashdb::File{ datafile(active - 1), ashdb::File::Mode::Read }).has_value());
+    BOOST_TEST(!std::filesystem::exists(datafile(active - 1) + "idx"));
+    BOOST_TEST(std::filesystem::exists(datafile(start) + "idx"));
+
+    const auto count = db.size();
+    BOOST_TEST(db.write(project::Person::CreatePerson(count)) == ashdb::WriteStatus::OK);
+
+    const auto records = db.read(0, count + 1);
+    for (auto i = 0u; i < records.size(); ++i)
+    {
+        BOOST_REQUIRE((records[i] == project::Person::CreatePerson(i)));
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
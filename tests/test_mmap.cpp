@@ -0,0 +1,142 @@
+#include <boost/test/unit_test.hpp>
+#include <boost/test/data/test_case.hpp>
+
+#include "../include/ashdb/ashdb.h"
+#include "../include/ashdb/status.h"
+
+#include "Test.h"
+#include "Person.h"
+
+namespace data = boost::unit_test::data;
+
+using StringDB = ashdb::AshDB<std::string>;
+
+BOOST_AUTO_TEST_SUITE(mmap)
+
+BOOST_AUTO_TEST_CASE(memory_stream)
+{
+    const std::string buffer = "0123456789";
+    ashdb::MemoryStream stream{ buffer.data(), buffer.size() };
+    stream.exceptions(std::istream::badbit | std::istream::failbit);
+
+    char c;
+    stream.seekg(5);
+    stream.read(&c, 1);
+    BOOST_TEST(c == '5');
+    BOOST_TEST(stream.tellg() == 6);
+
+    stream.seekg(0);
+    std::string temp(4, '\0');
+    stream.read(temp.data(), 4);
+    BOOST_TEST(temp == "0123");
+
+    stream.seekg(8);
+    BOOST_CHECK_THROW(stream.read(temp.data(), 4), std::ios_base::failure);
+}
+
+BOOST_AUTO_TEST_CASE(mmap_reads)
+{
+    auto tempFolder = ashdb::test::tempFolder("mmap_reads");
+
+    ashdb::Options options;
+    options.filesize_max = 1024;
+    options.mmap_sealed_segments = true;
+
+    auto db = std::make_unique<project::PersonDB>(tempFolder, options);
+    BOOST_TEST(db->open() == ashdb::OpenStatus::OK);
+
+    for (auto i = 0u; i < 100; ++i)
+    {
+        BOOST_TEST(db->write(project::Person::CreatePerson(i)) == ashdb::WriteStatus::OK);
+
+        // reading the active segment as it is being written
+        BOOST_TEST((db->read(i) == project::Person::CreatePerson(i)));
+    }
+
+    BOOST_TEST(db->activeSegmentNumber() > 2);
+
+    for (auto i = 0u; i < 100; ++i)
+    {
+        BOOST_TEST((db->read(i) == project::Person::CreatePerson(i)));
+    }
+
+    const auto batch = db->read(10, 90);
+    BOOST_TEST(batch.size() == 90);
+    for (auto i = 0u; i < batch.size(); ++i)
+    {
+        BOOST_TEST((batch[i] == project::Person::CreatePerson(i + 10)));
+    }
+
+    db->close();
+    BOOST_TEST(db->open() == ashdb::OpenStatus::OK);
+    for (auto i = 0u; i < 100; ++i)
+    {
+        BOOST_TEST((db->read(i) == project::Person::CreatePerson(i)));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(mmap_retention)
+{
+    auto tempFolder = ashdb::test::tempFolder("mmap_retention");
+
+    ashdb::Options options;
+    options.filesize_max = 100;
+    options.database_max = 500;
+    options.mmap_sealed_segments = true;
+
+    auto db = std::make_unique<StringDB>(tempFolder, options);
+    BOOST_TEST(db->open() == ashdb::OpenStatus::OK);
+
+    for (auto x = 0u; x < 20; ++x)
+    {
+        BOOST_TEST(db->write(std::string(110, 'A' + x)) == ashdb::WriteStatus::OK);
+
+        // keep the oldest segment mapped so that retention has to drop it
+        BOOST_TEST(db->read(*db->startIndex()) == std::string(110, 'A' + *db->startIndex()));
+    }
+
+    BOOST_TEST(db->startSegmentNumber() > 0);
+    for (auto i = *db->startIndex(); i <= *db->lastIndex(); ++i)
+    {
+        BOOST_TEST(db->read(i) == std::string(110, 'A' + i));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(mmap_truncate)
+{
+    auto tempFolder = ashdb::test::tempFolder("mmap_truncate");
+
+    ashdb::Options options;
+    options.filesize_max = 1024;
+    options.mmap_sealed_segments = true;
+
+    auto db = std::make_unique<project::PersonDB>(tempFolder, options);
+    BOOST_TEST(db->open() == ashdb::OpenStatus::OK);
+
+    project::PersonDB::Batch batch;
+    for (auto i = 0u; i < 100; ++i)
+    {
+        batch.push_back(project::Person::CreatePerson(i));
+    }
+    BOOST_TEST(db->write(batch) == ashdb::WriteStatus::OK);
+
+    // map every segment before truncating into the middle of one of them
+    BOOST_TEST(db->read(0, 100).size() == 100);
+    db->truncate(50);
+    BOOST_TEST(db->size() == 50);
+
+    batch.clear();
+    for (auto i = 0u; i < 50; ++i)
+    {
+        batch.push_back(project::Person::CreatePerson(i * 2));
+    }
+    BOOST_TEST(db->write(batch) == ashdb::WriteStatus::OK);
+
+    for (auto i = 0u; i < 50; ++i)
+    {
+        BOOST_TEST((db->read(i) == project::Person::CreatePerson(i)));
+        BOOST_TEST((db->read(i + 50) == project::Person::CreatePerson(i * 2)));
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,148 @@
+#include <atomic>
+#include <mutex>
+#include <set>
+#include <thread>
+
+#include <boost/test/unit_test.hpp>
+#include <boost/test/data/test_case.hpp>
+
+#include "Test.h"
+
+#include "../include/ashdb/ashdb.h"
+#include "../include/ashdb/primitives.h"
+#include "../include/ashdb/threadpool.h"
+
+#include "Person.h"
+
+namespace data = boost::unit_test::data;
+
+BOOST_AUTO_TEST_SUITE(parallel)
+
+BOOST_AUTO_TEST_CASE(thread_pool_for_each)
+{
+    ashdb::ThreadPool pool{ 4 };
+    BOOST_TEST(pool.size() == 4u);
+
+    std::vector<std::atomic_int> calls(1000);
+    pool.forEach(calls.size(), 0, [&calls](std::size_t i)
+    {
+        calls[i]++;
+    });
+
+    for (const auto& count : calls)
+    {
+        BOOST_TEST(count == 1);
+    }
+
+    // tasks can run parallel loops of their own without running out of workers
+    std::atomic_int nested = 0;
+    pool.forEach(8, 0, [&pool, &nested](std::size_t)
+    {
+        pool.forEach(8, 0, [&nested](std::size_t) { nested++; });
+    });
+    BOOST_TEST(nested == 64);
+
+    // at most `parallelism` tasks run at once
+    std::atomic_int running = 0;
+    std::atomic_int most = 0;
+    pool.forEach(64, 2, [&running, &most](std::size_t)
+    {
+        const auto now = ++running;
+        most = std::max(most.load(), now);
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+        running--;
+    });
+    BOOST_TEST(most <= 2);
+
+    BOOST_CHECK_THROW(pool.forEach(100, 0, [](std::size_t i)
+    {
+        if (i == 42)
+        {
+            throw std::runtime_error("failed");
+        }
+    }), std::runtime_error);
+}
+
+BOOST_DATA_TEST_CASE(parallel_for_each, data::make({ 0u, 1u, 3u }), threads)
+{
+    auto tempFolder = ashdb::test::tempFolder("parallel_for_each");
+
+    ashdb::Options options;
+    options.filesize_max = 64 * 1024;
+    options.worker_threads = 4;
+
+    project::PersonDB db{ tempFolder, options };
+    BOOST_TEST(db.open() == ashdb::OpenStatus::OK);
+
+    project::PersonDB::Batch batch;
+    for (auto i = 0u; i < 40000; ++i)
+    {
+        batch.push_back(project::Person::CreatePerson(i));
+    }
+    BOOST_TEST(db.write(batch) == ashdb::WriteStatus::OK);
+    BOOST_TEST(db.segmentIndices().size() > 1u);
+
+    std::mutex mutex;
+    std::set<std::string> names;
+    db.parallelForEach(100, 39900, [&mutex, &names](const project::Person& person)
+    {
+        std::scoped_lock lock{ mutex };
+        names.insert(person.name.first);
+    }, threads);
+
+    BOOST_TEST(names.size() == 39800u);
+    BOOST_TEST(names.count("Firstname100") == 1u);
+    BOOST_TEST(names.count("Firstname39899") == 1u);
+    BOOST_TEST(names.count("Firstname39900") == 0u);
+
+    BOOST_CHECK_THROW(db.parallelForEach(0, 40001, [](const project::Person&) {}, threads),
+                      std::runtime_error);
+}
+
+BOOST_DATA_TEST_CASE(parallel_transform_reduce, data::make({ 0u, 1u, 3u }), threads)
+{
+    auto tempFolder = ashdb::test::tempFolder("parallel_transform_reduce");
+
+    ashdb::Options options;
+    options.filesize_max = 16 * 1024;
+    options.worker_threads = 4;
+
+    ashdb::AshDB<std::uint32_t> db{ tempFolder, options };
+    BOOST_TEST(db.open() == ashdb::OpenStatus::OK);
+
+    ashdb::AshDB<std::uint32_t>::Batch batch;
+    for (auto i = 0u; i < 100000; ++i)
+    {
+        batch.push_back(i);
+    }
+    BOOST_TEST(db.write(batch) == ashdb::WriteStatus::OK);
+
+    const auto sum = db.parallelTransformReduce(0, db.size(), std::uint64_t{ 0 },
+        [](std::uint64_t a, std::uint64_t b) { return a + b; },
+        [](std::uint32_t value) { return std::uint64_t{ value }; },
+        threads);
+    BOOST_TEST(sum == 99999ull * 100000ull / 2);
+
+    // the partial results are combined in record order, so even a reduction
+    // that is not commutative gives the same result every time
+    const auto concatenate = [&db, threads]()
+    {
+        return db.parallelTransformReduce(1000, 91000, std::string{ ">" },
+            [](std::string a, const std::string& b) { a += b; return a; },
+            [](std::uint32_t value) { return std::string(1, static_cast<char>('a' + (value % 26))); },
+            threads);
+    };
+
+    const auto expected = concatenate();
+    BOOST_REQUIRE(expected.size() == 90001u);
+    BOOST_TEST(expected.substr(0, 4) == ">mno");
+    for (auto i = 0; i < 3; ++i)
+    {
+        BOOST_TEST(concatenate() == expected);
+    }
+
+    BOOST_TEST(db.parallelTransformReduce(5, 5, 7, std::plus<int>{},
+        [](std::uint32_t) { return 1; }) == 7);
+}
+
+BOOST_AUTO_TEST_SUITE_END() // parallel
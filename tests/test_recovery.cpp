@@ -0,0 +1,283 @@
+#include <filesystem>
+#include <fstream>
+#include <map>
+
+#include <boost/test/unit_test.hpp>
+#include <boost/test/data/test_case.hpp>
+
+#include "../include/ashdb/ashdb.h"
+
+#include "Test.h"
+#include "Person.h"
+
+namespace data = boost::unit_test::data;
+namespace fs = std::filesystem;
+
+BOOST_TEST_DONT_PRINT_LOG_VALUE(ashdb::Compression)
+
+namespace
+{
+
+// what is left of a database when a process dies between appending the
+// records of a write to the data file and appending their index entries
+void dropIndexEntries(const std::string& indexfile, std::size_t count)
+{
+    fs::resize_file(indexfile, fs::file_size(indexfile) - (count * sizeof(std::size_t)));
+}
+
+// the sizes of every file in the database folder
+std::map<std::string, std::uintmax_t> fileSizes(const std::string& folder)
+{
+    std::map<std::string, std::uintmax_t> sizes;
+    for (const auto& entry : fs::directory_iterator{ folder })
+    {
+        sizes[entry.path().filename().string()] = fs::file_size(entry.path());
+    }
+    return sizes;
+}
+
+void appendBytes(const std::string& filename, const char* data, std::size_t size)
+{
+    std::ofstream out{ filename, std::ios::binary | std::ios::app };
+    out.write(data, static_cast<std::streamsize>(size));
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(recovery)
+
+BOOST_DATA_TEST_CASE(recover_index_entries,
+    data::make({ false, true }) * data::make({ ashdb::Compression::NONE, ashdb::Compression::LZ }),
+    checksums, compression)
+{
+    auto tempFolder = ashdb::test::tempFolder("recover_index_entries");
+
+    ashdb::Options options;
+    options.filesize_max = 64 * 1024;
+    options.checksums = checksums;
+    options.compression = compression;
+    options.compression_block_size = 1024;
+
+    std::string indexfile;
+    {
+        project::PersonDB db{ tempFolder, options };
+        BOOST_TEST(db.open() == ashdb::OpenStatus::OK);
+        for (auto i = 0u; i < 1000; ++i)
+        {
+            BOOST_TEST(db.write(project::Person::CreatePerson(i)) == ashdb::WriteStatus::OK);
+        }
+        BOOST_TEST(db.segmentIndices().size() == 1u);
+        indexfile = db.activeIndexFile();
+    }
+
+    const auto indexSize = fs::file_size(indexfile);
+    dropIndexEntries(indexfile, 25);
+
+    project::PersonDB db{ tempFolder, options };
+    BOOST_TEST(db.open() == ashdb::OpenStatus::OK);
+    BOOST_TEST(db.size() == 1000u);
+    BOOST_TEST(fs::file_size(indexfile) == indexSize);
+
+    BOOST_TEST((db.read(974) == project::Person::CreatePerson(974)));
+    BOOST_TEST((db.read(999) == project::Person::CreatePerson(999)));
+
+    BOOST_TEST(db.write(project::Person::CreatePerson(1000)) == ashdb::WriteStatus::OK);
+    db.close();
+    BOOST_TEST(db.open() == ashdb::OpenStatus::OK);
+
+    const auto records = db.read(0, 1001);
+    for (auto i = 0u; i < records.size(); ++i)
+    {
+        BOOST_REQUIRE((records[i] == project::Person::CreatePerson(i)));
+    }
+}
+
+BOOST_DATA_TEST_CASE(recover_partial_record, data::make({ false, true }), checksums)
+{
+    auto tempFolder = ashdb::test::tempFolder("recover_partial_record");
+
+    ashdb::Options options;
+    options.checksums = checksums;
+
+    std::string datafile;
+    std::string indexfile;
+    {
+        project::PersonDB db{ tempFolder, options };
+        BOOST_TEST(db.open() == ashdb::OpenStatus::OK);
+        for (auto i = 0u; i < 100; ++i)
+        {
+            BOOST_TEST(db.write(project::Person::CreatePerson(i)) == ashdb::WriteStatus::OK);
+        }
+        datafile = db.activeDataFile();
+        indexfile = db.activeIndexFile();
+    }
+
+    const auto dataSize = fs::file_size(datafile);
+    const auto indexSize = fs::file_size(indexfile);
+
+    // the start of a record that was never finished, whose index entry and
+    // part of the entry after it did make it to disk
+    std::stringstream stream;
+    ashdb_write(stream, project::Person::CreatePerson(100));
+    const auto record = stream.str();
+    appendBytes(datafile, record.data(), record.size() / 2);
+
+    const std::size_t entries[2] = { static_cast<std::size_t>(dataSize), static_cast<std::size_t>(dataSize) + 1000 };
+    appendBytes(indexfile, reinterpret_cast<const char*>(entries), sizeof(entries) - 3);
+
+    project::PersonDB db{ tempFolder, options };
+    BOOST_TEST(db.open() == ashdb::OpenStatus::OK);
+    BOOST_TEST(db.size() == 100u);
+    BOOST_TEST(fs::file_size(datafile) == dataSize);
+    BOOST_TEST(fs::file_size(indexfile) == indexSize);
+    BOOST_TEST((db.read(99) == project::Person::CreatePerson(99)));
+
+    BOOST_TEST(db.write(project::Person::CreatePerson(100)) == ashdb::WriteStatus::OK);
+    db.close();
+    BOOST_TEST(db.open() == ashdb::OpenStatus::OK);
+
+    const auto records = db.read(0, 101);
+    for (auto i = 0u; i < records.size(); ++i)
+    {
+        BOOST_REQUIRE((records[i] == project::Person::CreatePerson(i)));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(recover_new_segment)
+{
+    auto tempFolder = ashdb::test::tempFolder("recover_new_segment");
+
+    ashdb::Options options;
+    options.filesize_max = 4096;
+    options.checksums = true;
+
+    std::string indexfile;
+    std::size_t first = 0;
+    {
+        project::PersonDB db{ tempFolder, options };
+        BOOST_TEST(db.open() == ashdb::OpenStatus::OK);
+        for (auto i = 0u; i < 500; ++i)
+        {
+            BOOST_TEST(db.write(project::Person::CreatePerson(i)) == ashdb::WriteStatus::OK);
+        }
+        BOOST_TEST(db.segmentIndices().size() > 1u);
+        indexfile = db.activeIndexFile();
+        first = db.segmentIndices().back().at(0);
+    }
+
+    // not even the record number of the segment's first record was written
+    fs::resize_file(indexfile, 0);
+
+    project::PersonDB db{ tempFolder, options };
+    BOOST_TEST(db.open() == ashdb::OpenStatus::OK);
+    BOOST_TEST(db.size() == 500u);
+    BOOST_TEST(db.segmentIndices().back().at(0) == first);
+
+    const auto records = db.read(0, 500);
+    for (auto i = 0u; i < records.size(); ++i)
+    {
+        BOOST_REQUIRE((records[i] == project::Person::CreatePerson(i)));
+    }
+}
+
+BOOST_DATA_TEST_CASE(recover_raw_records, data::make({ false, true }), checksums)
+{
+    auto tempFolder = ashdb::test::tempFolder("recover_raw_records");
+
+    ashdb::Options options;
+    options.checksums = checksums;
+
+    std::string datafile;
+    std::string indexfile;
+    {
+        ashdb::AshDB<std::uint64_t> db{ tempFolder, options };
+        BOOST_TEST(db.open() == ashdb::OpenStatus::OK);
+        for (auto i = 0u; i < 100; ++i)
+        {
+            BOOST_TEST(db.write(std::uint64_t{ i } * 3) == ashdb::WriteStatus::OK);
+        }
+        datafile = db.activeDataFile();
+        indexfile = db.activeIndexFile();
+    }
+
+    const auto slot = sizeof(std::uint64_t) + (checksums ? ashdb::CHECKSUM_SIZE : 0);
+    BOOST_TEST(fs::file_size(datafile) == 100 * slot);
+
+    // the entries of the last 10 records are lost along with half of the
+    // bytes of the last one
+    dropIndexEntries(indexfile, 10);
+    fs::resize_file(datafile, fs::file_size(datafile) - (slot / 2));
+
+    ashdb::AshDB<std::uint64_t> db{ tempFolder, options };
+    BOOST_TEST(db.open() == ashdb::OpenStatus::OK);
+    BOOST_TEST(db.size() == 99u);
+    BOOST_TEST(fs::file_size(datafile) == 99 * slot);
+    BOOST_TEST(db.read(98) == 294u);
+
+    BOOST_TEST(db.write(std::uint64_t{ 1234 }) == ashdb::WriteStatus::OK);
+    BOOST_TEST(db.read(99) == 1234u);
+    BOOST_TEST(db.read(97) == 291u);
+}
+
+BOOST_DATA_TEST_CASE(format_mismatch, data::xrange(6) * data::make({ false, true }), mismatch, sealed)
+{
+    auto tempFolder = ashdb::test::tempFolder("format_mismatch");
+
+    ashdb::Options written;
+    written.filesize_max = sealed ? 256 : 0;
+    auto opened = written;
+    switch (mismatch)
+    {
+        case 0:
+            written.compression = ashdb::Compression::LZ;
+            break;
+        case 1:
+            opened.compression = ashdb::Compression::LZ;
+            break;
+        case 2:
+            written.checksums = true;
+            break;
+        case 3:
+            opened.checksums = true;
+            break;
+        case 4:
+            written.fixed_record_size = sizeof(std::uint64_t);
+            break;
+        default:
+            opened.fixed_record_size = sizeof(std::uint64_t);
+            break;
+    }
+
+    {
+        ashdb::AshDB<std::uint64_t> db{ tempFolder, written };
+        BOOST_TEST(db.open() == ashdb::OpenStatus::OK);
+        for (auto i = 0u; i < 100; ++i)
+        {
+            BOOST_TEST(db.write(std::uint64_t{ i } * 3) == ashdb::WriteStatus::OK);
+        }
+        BOOST_TEST((db.segmentIndices().size() > 1u) == sealed);
+    }
+
+    // nothing is recovered, or cut short, with the wrong options and the
+    // database is left as it was
+    const auto sizes = fileSizes(tempFolder);
+    {
+        ashdb::AshDB<std::uint64_t> db{ tempFolder, opened };
+        const auto active = db.activeDataFile();
+        const auto databaseSize = db.databaseSize();
+        BOOST_TEST(db.open() == ashdb::OpenStatus::FORMAT_MISMATCH);
+        BOOST_TEST(!db.opened());
+        BOOST_TEST(db.activeDataFile() == active);
+        BOOST_TEST(db.segmentIndices().empty());
+        BOOST_TEST(db.databaseSize() == databaseSize);
+    }
+    BOOST_TEST((fileSizes(tempFolder) == sizes));
+
+    ashdb::AshDB<std::uint64_t> db{ tempFolder, written };
+    BOOST_TEST(db.open() == ashdb::OpenStatus::OK);
+    BOOST_TEST(db.size() == 100u);
+    BOOST_TEST(db.read(0) == 0u);
+    BOOST_TEST(db.read(99) == 297u);
+}
+
+BOOST_AUTO_TEST_SUITE_END() // recovery